@@ -0,0 +1,157 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * basic.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cctype>
+#include <cstring>
+
+#include <basic.h>
+
+
+/* keyword table in ROM order ($a09e), the token is 0x80 + index */
+const char *BasicTokenizer::kKeywords[] = {
+  "END", "FOR", "NEXT", "DATA", "INPUT#", "INPUT", "DIM", "READ",
+  "LET", "GOTO", "RUN", "IF", "RESTORE", "GOSUB", "RETURN", "REM",
+  "STOP", "ON", "WAIT", "LOAD", "SAVE", "VERIFY", "DEF", "POKE",
+  "PRINT#", "PRINT", "CONT", "LIST", "CLR", "CMD", "SYS", "OPEN",
+  "CLOSE", "GET", "NEW", "TAB(", "TO", "FN", "SPC(", "THEN",
+  "NOT", "STEP", "+", "-", "*", "/", "^", "AND",
+  "OR", ">", "=", "<", "SGN", "INT", "ABS", "USR",
+  "FRE", "POS", "SQR", "RND", "LOG", "EXP", "COS", "SIN",
+  "TAN", "ATN", "PEEK", "LEN", "STR$", "VAL", "ASC", "CHR$",
+  "LEFT$", "RIGHT$", "MID$", "GO",
+  nullptr
+};
+
+BasicTokenizer::BasicTokenizer(uint16_t start) :
+  start_(start),
+  dropped_(0)
+{
+}
+
+/**
+ * @brief add a line of the listing
+ * @return false if the line has no (valid) line number,
+ * it is then meant to be typed in direct mode
+ */
+bool BasicTokenizer::add_line(const std::string &line)
+{
+  size_t i = 0;
+  while (i < line.size() && line[i] == ' ') i++;
+  if (i == line.size() || !isdigit((unsigned char)line[i])) return false;
+  unsigned int number = 0;
+  while (i < line.size() && (isdigit((unsigned char)line[i]) || line[i] == ' '))
+  {
+    if (line[i] != ' ') number = (number * 10) + (line[i] - '0');
+    if (number > kMaxLineNumber) return false; /* ?SYNTAX ERROR */
+    i++;
+  }
+  /* the editor drops trailing spaces from the screen line */
+  size_t end = line.find_last_not_of(' ');
+  std::vector<uint8_t> tokens = crunch(line.substr(i, end + 1 - i));
+  if (tokens.empty())
+    lines_.erase(number);
+  else
+    lines_[number] = tokens;
+  return true;
+}
+
+/**
+ * @brief crunch line text into tokens
+ */
+std::vector<uint8_t> BasicTokenizer::crunch(const std::string &text)
+{
+  std::vector<uint8_t> out;
+  bool quote = false, rem = false, data = false;
+  for (size_t i = 0 ; i < text.size() ; i++)
+  {
+    uint8_t c = toupper((unsigned char)text[i]);
+    if (c == '\t') c = ' ';
+    if (c < 0x20 || c > 0x5f) { /* not in unshifted PETSCII */
+      dropped_++;
+      continue;
+    }
+    if (rem) {
+      out.push_back(c);
+      continue;
+    }
+    if (c == '"') quote = !quote;
+    if (quote || c == '"') {
+      out.push_back(c);
+      continue;
+    }
+    if (data) {
+      if (c == ':') data = false;
+      out.push_back(c);
+      continue;
+    }
+    /* digits, ':', ';' and spaces never start a keyword */
+    if (c == ' ' || (c >= '0' && c <= ';')) {
+      out.push_back(c);
+      continue;
+    }
+    if (c == '?') {
+      out.push_back(kTokenPrint);
+      continue;
+    }
+    uint8_t token = 0;
+    for (int k = 0 ; kKeywords[k] != nullptr ; k++)
+    {
+      size_t len = strlen(kKeywords[k]);
+      if (i + len > text.size()) continue;
+      size_t n = 0;
+      while (n < len && toupper((unsigned char)text[i + n]) == kKeywords[k][n]) n++;
+      if (n == len) {
+        token = (kTokenFirst + k);
+        i += (len - 1);
+        break;
+      }
+    }
+    if (token == 0) {
+      out.push_back(c);
+      continue;
+    }
+    out.push_back(token);
+    if (token == kTokenRem) rem = true;
+    if (token == kTokenData) data = true;
+  }
+  return out;
+}
+
+/**
+ * @brief linked program image, loaded at the start address
+ */
+std::vector<uint8_t> BasicTokenizer::program()
+{
+  std::vector<uint8_t> prg;
+  uint16_t addr = start_;
+  for (auto &l : lines_)
+  {
+    addr += (4 + l.second.size() + 1);
+    prg.push_back(addr & 0xff);
+    prg.push_back(addr >> 8);
+    prg.push_back(l.first & 0xff);
+    prg.push_back(l.first >> 8);
+    prg.insert(prg.end(), l.second.begin(), l.second.end());
+    prg.push_back(0);
+  }
+  prg.push_back(0);
+  prg.push_back(0);
+  return prg;
+}
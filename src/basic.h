@@ -0,0 +1,81 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * basic.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_BASIC_H
+#define EMUDORE_BASIC_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief BASIC V2 tokenizer
+ *
+ * Turns a text listing into a tokenized program the same way
+ * the ROM editor crunches typed lines:
+ *
+ *  - keywords are replaced by their token, first match in
+ *    ROM table order wins, '?' is PRINT
+ *  - text in quotes, after REM and after DATA (up to the next
+ *    ':') is copied as is
+ *  - spaces after the line number are dropped, all others kept
+ *  - lowercase is stored as unshifted (uppercase) PETSCII,
+ *    tabs as spaces, characters without a PETSCII code are
+ *    dropped and counted
+ *
+ * Lines are kept sorted by number, a line number without text
+ * deletes that line.
+ *
+ * Program layout from the start address:
+ *
+ *  line  u16 address of next line, u16 line number, tokens, 0
+ *  end   u16 0
+ */
+class BasicTokenizer
+{
+  public:
+    BasicTokenizer(uint16_t start);
+
+    bool add_line(const std::string &line);
+    void clear(){lines_.clear();};
+    bool empty(){return lines_.empty();};
+    std::vector<uint8_t> program();
+    size_t dropped(){return dropped_;};
+
+    static constexpr uint16_t kMaxLineNumber = 63999;
+
+  private:
+    uint16_t start_;
+    size_t dropped_;
+    std::map<uint16_t,std::vector<uint8_t>> lines_;
+
+    static const char *kKeywords[];
+    static constexpr uint8_t kTokenFirst = 0x80;
+    static constexpr uint8_t kTokenData  = 0x83;
+    static constexpr uint8_t kTokenRem   = 0x8f;
+    static constexpr uint8_t kTokenPrint = 0x99;
+
+    std::vector<uint8_t> crunch(const std::string &text);
+};
+
+
+#endif /* EMUDORE_BASIC_H */
@@ -21,6 +21,7 @@
 #include "timer.cpp"
 
 #include <c64.h>
+#include <snapshot.h>
 #include <util.h>
 
 #if EMBEDDED
@@ -135,6 +136,9 @@ C64::C64(
   debugger_->memory(mem_);
   debugger_->cpu(cpu_);
   #endif
+  #if DESKTOP
+  snapshot_ = nullptr;
+  #endif
 
   runloop = true; /* Enable looping */
 }
@@ -154,12 +158,34 @@ C64::~C64()
   #if DEBUGGER_SUPPORT
   delete debugger_;
   #endif
+  #if DESKTOP
+  if (snapshot_ != nullptr) delete snapshot_;
+  #endif
 
   #if EMBEDDED
   reset_sid();
   #endif
 }
 
+#if DESKTOP
+/**
+ * @brief skip the KERNAL cold start
+ * Restores the machine at the READY prompt from the boot
+ * snapshot, without one the machine boots normally and the
+ * snapshot is saved when the prompt is first reached
+ */
+void C64::boot_snapshot()
+{
+  if (!Snapshot::enabled || havecart || acia) return;
+  snapshot_ = new Snapshot(this);
+  if (snapshot_->restore()) {
+    io_->reset(); /* pacing restarts from the restored clock */
+    delete snapshot_;
+    snapshot_ = nullptr;
+  }
+}
+#endif
+
 /**
  * @brief run c64 continuously
  */
@@ -181,6 +207,12 @@ void C64::start()
     #endif
     #if DESKTOP
     if (log_timings) BT->MeasurementStart();
+    /* first READY prompt without a boot snapshot */
+    if(snapshot_ != nullptr && cpu_->pc() == 0xa65c) {
+      snapshot_->save();
+      delete snapshot_;
+      snapshot_ = nullptr;
+    }
     /* callback executes _before_ first emulation run */
     if(callback_ && cpu_->pc() == 0xa65c) {callback_(); /* cpu_->idf(false); cpu_->irq(); */}
     if (log_timings) BT->MeasurementEnd();
@@ -29,19 +29,28 @@
 class C64;
 class Cpu;
 class PLA;
-class Cia1;
-class Cia2;
+struct Cia1Variant;
+struct Cia2Variant;
+template <class Variant> class Cia;
+typedef Cia<Cia1Variant> Cia1;
+typedef Cia<Cia2Variant> Cia2;
 class Vic;
+class VicRenderer;
+struct VicLine;
 class IO;
+class VideoCapture;
+class StateHash;
+class Snapshot;
 class Cart;
 class Sid;
+class SidReadback;
 
 #include <memory.h>
 #include <cpu.h>
 #include <pla.h>
-#include <cia1.h>
-#include <cia2.h>
+#include <cia.h>
 #include <vic.h>
+#include <vicrenderer.h>
 #include <io.h>
 #include <cart.h>
 #include <sidadapter.h>
@@ -110,6 +119,9 @@ class C64
   #if DESKTOP && DEBUGGER_SUPPORT
     Debugger *debugger_;
   #endif
+  #if DESKTOP
+    Snapshot *snapshot_; /* pending save at the READY prompt */
+  #endif
   public:
     bool nosdl = false;
     bool isbinary = false;
@@ -141,6 +153,9 @@ class C64
     bool disable_looping(void){runloop=false;return runloop;};
 
     void callback(std::function<bool()> cb){callback_ = cb;};
+    #if DESKTOP
+    void boot_snapshot(void);
+    #endif
 
     Cpu * cpu(){return cpu_;};
     PLA * pla(){return pla_;};
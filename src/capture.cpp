@@ -0,0 +1,288 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * capture.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <c64.h>
+#include <capture.h>
+
+#if DESKTOP
+
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+
+// ctor and dtor /////////////////////////////////////////////////////////////
+
+VideoCapture::VideoCapture(const std::string &path, kFormat format,
+                           size_t cols, size_t rows, const uint32_t *palette) :
+  format_(format),
+  cols_(cols),
+  rows_(rows),
+  running_(true),
+  threaded_(false),
+  have_prev_(false),
+  frames_(0),
+  dropped_(0),
+  bytes_(0)
+{
+  for(int i = 0 ; i < 16 ; i++)
+  {
+    palette_[i] = palette[i];
+    /* BT.601 limited range */
+    double r = ((palette[i] >> 16) & 0xff);
+    double g = ((palette[i] >> 8) & 0xff);
+    double b = (palette[i] & 0xff);
+    yuv_palette_[i][0] = (uint8_t)( 16.0 + ( 0.2568 * r) + (0.5041 * g) + (0.0979 * b) + 0.5);
+    yuv_palette_[i][1] = (uint8_t)(128.0 + (-0.1482 * r) - (0.2910 * g) + (0.4392 * b) + 0.5);
+    yuv_palette_[i][2] = (uint8_t)(128.0 + ( 0.4392 * r) - (0.3678 * g) - (0.0714 * b) + 0.5);
+  }
+  for(size_t i = 0 ; i < kBuffers ; i++)
+  {
+    buffers_[i] = new uint32_t[cols_ * rows_]();
+    free_.push(buffers_[i]);
+  }
+  index_      = new uint8_t[cols_ * rows_]();
+  prev_index_ = new uint8_t[cols_ * rows_]();
+  line_       = new uint8_t[(cols_ * 2) + 1];
+  yuv_        = new uint8_t[cols_ * rows_ * 3];
+
+  out_ = fopen(path.c_str(), "wb");
+  if (out_ == nullptr) {
+    fprintf(stderr, "[CAPTURE] Unable to open %s for writing\n", path.c_str());
+    return;
+  }
+  write_header();
+  int error = pthread_create(&threadid_, NULL, &_Writer_Thread, this);
+  if (error != 0) {
+    /* fall back to writing on the emulation thread */
+    fprintf(stderr, "[CAPTURE] Writer thread can't be created :[%s]\n", strerror(error));
+  } else {
+    threaded_ = true;
+  }
+  D("[EMU] VideoCapture initialized (%s).\n",(format_ == kY4M ? "y4m" : "raw"));
+}
+
+VideoCapture::~VideoCapture()
+{
+  running_.store(false, std::memory_order_release);
+  if (threaded_) pthread_join(threadid_, NULL);
+  if (out_ != nullptr) {
+    fclose(out_);
+    printf("[CAPTURE] %u frames, %u dropped, %lu bytes written\n",
+      frames_, dropped_, (unsigned long)bytes_);
+  }
+  for(size_t i = 0 ; i < kBuffers ; i++)
+  {
+    delete [] buffers_[i];
+  }
+  delete [] index_;
+  delete [] prev_index_;
+  delete [] line_;
+  delete [] yuv_;
+}
+
+// emulation thread //////////////////////////////////////////////////////////
+
+/**
+ * @brief queue a finished frame
+ *
+ * Never blocks, if the writer has no free buffer left the
+ * frame is dropped and counted.
+ */
+void VideoCapture::push(const uint32_t *frame)
+{
+  if (out_ == nullptr) return;
+  if (!threaded_) {
+    write_frame(frame);
+    return;
+  }
+  /* take the slot in full_ before the buffer, only the writer
+     may hand buffers back to free_ */
+  uint32_t **slot = full_.acquire();
+  uint32_t *buf;
+  if (slot == nullptr || !free_.pop(buf)) {
+    dropped_++;
+    return;
+  }
+  memcpy(buf, frame, cols_ * rows_ * sizeof(uint32_t));
+  *slot = buf;
+  full_.publish();
+}
+
+/**
+ * @brief repeat the previous frame (skipped frames)
+ */
+void VideoCapture::repeat()
+{
+  if (out_ == nullptr) return;
+  if (!threaded_) {
+    write_frame(nullptr);
+    return;
+  }
+  uint32_t **slot = full_.acquire();
+  if (slot == nullptr) { /* queue full, nothing to repeat into */
+    dropped_++;
+    return;
+  }
+  *slot = nullptr;
+  full_.publish();
+}
+
+// writer thread /////////////////////////////////////////////////////////////
+
+void *VideoCapture::writer_thread(void)
+{
+  pthread_setname_np(pthread_self(), "Capture Thread");
+  while (true) {
+    uint32_t *buf;
+    if (full_.pop(buf)) {
+      write_frame(buf);
+      if (buf != nullptr) free_.push(buf);
+      continue;
+    }
+    /* drain everything before leaving */
+    if (!running_.load(std::memory_order_acquire)) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  fflush(out_);
+  return NULL;
+}
+
+void VideoCapture::put(const void *p, size_t n)
+{
+  bytes_ += fwrite(p, 1, n, out_);
+}
+
+void VideoCapture::write_header()
+{
+  if (format_ == kY4M) {
+    char hdr[96];
+    int n = snprintf(hdr, sizeof(hdr),
+      "YUV4MPEG2 W%u H%u F50125:1000 Ip A1:1 C444\n",
+      (unsigned int)cols_, (unsigned int)rows_);
+    put(hdr, n);
+    return;
+  }
+  uint8_t hdr[8 + 4 + 8 + (16 * 3)];
+  size_t i = 0;
+  memcpy(hdr, "C64RAW1\0", 8); i += 8;
+  hdr[i++] = (cols_ & 0xff); hdr[i++] = ((cols_ >> 8) & 0xff);
+  hdr[i++] = (rows_ & 0xff); hdr[i++] = ((rows_ >> 8) & 0xff);
+  uint32_t num = 50125, den = 1000;
+  for(int b = 0 ; b < 4 ; b++) hdr[i++] = ((num >> (b * 8)) & 0xff);
+  for(int b = 0 ; b < 4 ; b++) hdr[i++] = ((den >> (b * 8)) & 0xff);
+  for(int c = 0 ; c < 16 ; c++)
+  {
+    hdr[i++] = ((palette_[c] >> 16) & 0xff);
+    hdr[i++] = ((palette_[c] >> 8) & 0xff);
+    hdr[i++] = (palette_[c] & 0xff);
+  }
+  put(hdr, i);
+}
+
+/**
+ * @brief map framebuffer colors back to palette indexes
+ */
+void VideoCapture::to_index(const uint32_t *frame)
+{
+  uint32_t last = palette_[0];
+  uint8_t last_idx = 0;
+  for(size_t p = 0 ; p < (cols_ * rows_) ; p++)
+  {
+    uint32_t px = frame[p];
+    if (px != last) {
+      last = px;
+      last_idx = 0;
+      for(uint8_t c = 0 ; c < 16 ; c++)
+      {
+        if (palette_[c] == px) {last_idx = c; break;}
+      }
+    }
+    index_[p] = last_idx;
+  }
+}
+
+void VideoCapture::write_frame(const uint32_t *frame)
+{
+  bool repeat = (frame == nullptr);
+  if (repeat && !have_prev_) return; /* nothing to repeat yet */
+  if (!repeat) to_index(frame);
+  if (format_ == kY4M)
+    write_y4m(repeat);
+  else
+    write_raw(repeat);
+  if (!repeat) {
+    uint8_t *t = prev_index_;
+    prev_index_ = index_;
+    index_ = t;
+    have_prev_ = true;
+  }
+  frames_++;
+}
+
+void VideoCapture::write_y4m(bool repeat)
+{
+  const size_t plane = (cols_ * rows_);
+  if (!repeat) {
+    for(size_t p = 0 ; p < plane ; p++)
+    {
+      const uint8_t *yuv = yuv_palette_[index_[p]];
+      yuv_[p]             = yuv[0];
+      yuv_[p + plane]     = yuv[1];
+      yuv_[p + plane * 2] = yuv[2];
+    }
+  }
+  put("FRAME\n", 6);
+  put(yuv_, plane * 3);
+}
+
+void VideoCapture::write_raw(bool repeat)
+{
+  put("F", 1);
+  for(size_t y = 0 ; y < rows_ ; y++)
+  {
+    const uint8_t *cur  = (repeat ? &prev_index_[y * cols_] : &index_[y * cols_]);
+    const uint8_t *prev = &prev_index_[y * cols_];
+    if (repeat || (have_prev_ && memcmp(cur, prev, cols_) == 0)) {
+      put(&kLineSame, 1);
+      continue;
+    }
+    /* run length encode, fall back to literal if that is smaller */
+    size_t n = 0;
+    line_[n++] = kLineRLE;
+    for(size_t x = 0 ; x < cols_ && n < cols_ + 1 ; )
+    {
+      uint8_t c = cur[x];
+      size_t run = 1;
+      while((x + run) < cols_ && run < 255 && cur[x + run] == c) run++;
+      line_[n++] = (uint8_t)run;
+      line_[n++] = c;
+      x += run;
+    }
+    if (n < cols_ + 1) {
+      put(line_, n);
+    } else {
+      put(&kLineLiteral, 1);
+      put(cur, cols_);
+    }
+  }
+}
+
+#endif /* DESKTOP */
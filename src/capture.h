@@ -0,0 +1,121 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * capture.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_CAPTURE_H
+#define EMUDORE_CAPTURE_H
+
+#if DESKTOP
+
+#include <cstdio>
+#include <string>
+#include <atomic>
+#include <pthread.h>
+
+#include <ringbuffer.h>
+
+
+/**
+ * @brief Video capture
+ *
+ * Writes rendered frames to a file or fifo from a background
+ * thread. Frame buffers are recycled through a pair of rings so
+ * the emulation thread only does a single memcpy per frame.
+ *
+ * Formats:
+ *
+ *  Y4M  YUV4MPEG2 4:4:4, playable by most video tools
+ *  RAW  indexed (one palette index per pixel), every line is
+ *       stored as unchanged, run length encoded or literal
+ *
+ * RAW stream layout, all values little endian:
+ *
+ *  header  "C64RAW1\0" u16 width u16 height
+ *          u32 rate numerator u32 rate denominator
+ *          16 x (r,g,b) palette
+ *  frame   'F' followed by one record per line:
+ *          kLineSame                         line did not change
+ *          kLineRLE     (count,index) pairs  runs of 1..255 pixels
+ *          kLineLiteral width x index        plain indices
+ */
+class VideoCapture
+{
+  public:
+    enum kFormat
+    {
+      kY4M,
+      kRaw,
+    };
+
+    VideoCapture(const std::string &path, kFormat format,
+                 size_t cols, size_t rows, const uint32_t *palette);
+    ~VideoCapture();
+
+    bool ok(){return out_ != nullptr;};
+    void push(const uint32_t *frame);
+    void repeat();
+
+    static void *_Writer_Thread(void *context)
+    { /* Required for supplying private function to pthread_create */
+      return ((VideoCapture *)context)->writer_thread();
+    }
+
+    static constexpr uint8_t kLineSame    = 0x00;
+    static constexpr uint8_t kLineRLE     = 0x01;
+    static constexpr uint8_t kLineLiteral = 0x02;
+
+  private:
+    static const size_t kBuffers = 8;
+    FILE *out_;
+    kFormat format_;
+    size_t cols_;
+    size_t rows_;
+    uint32_t palette_[16];
+    /* buffers travel emulation -> writer in full_, back in free_ */
+    uint32_t *buffers_[kBuffers];
+    RingBuffer<uint32_t *,kBuffers> full_;
+    RingBuffer<uint32_t *,kBuffers> free_;
+    /* a null frame in full_ means repeat the previous frame */
+    pthread_t threadid_;
+    std::atomic<bool> running_;
+    bool threaded_;
+    /* writer thread state */
+    uint8_t *index_;
+    uint8_t *prev_index_;
+    uint8_t *line_;
+    uint8_t *yuv_;
+    uint8_t yuv_palette_[16][3];
+    bool have_prev_;
+    /* statistics */
+    unsigned int frames_;
+    unsigned int dropped_;
+    uint64_t bytes_;
+
+    void *writer_thread(void);
+    void write_header();
+    void write_frame(const uint32_t *frame);
+    void write_y4m(bool repeat);
+    void write_raw(bool repeat);
+    void to_index(const uint32_t *frame);
+    void put(const void *p, size_t n);
+};
+
+#endif /* DESKTOP */
+
+#endif /* EMUDORE_CAPTURE_H */
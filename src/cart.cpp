@@ -67,7 +67,10 @@ Cart::~Cart()
 
 void Cart::deinit_cart(void)
 { /* RUN/STOP+RESTORE resets cart contents! or maybe not? */
-  if (acia_active) { delete mc6850_; }
+  if (acia_active) {
+    delete mc6850_;
+    c64_->cpu_->irq_line(Cpu::kIrqCart, false); /* release a pending ACIA IRQ */
+  }
   acia_active = false;
   midi = false;
   cartactive = false;
@@ -63,6 +63,7 @@ MC68B50::~MC68B50()
 void MC68B50::reset()
 {
   k6850MemRd[STATUS] = TDRE; /* Set TDRE default to empty */
+  irq_line();
 }
 
 /**
@@ -87,6 +88,7 @@ uint8_t MC68B50::read_register(uint8_t r)
     /* NOTE: Data in the RXDR should come from a ringbuffer that shifts after reading */
     case RXDR:    /* $de07 ~ RX register      ~ read only */
       k6850MemRd[STATUS] &= ~(IRQ|RDRF); /* Clear IRQ and RDRF on read (if set) */
+      irq_line();
       retval = k6850MemRd[RXDR];
       break;
     default:      /* default always return read */
@@ -208,7 +210,7 @@ inline void MC68B50::process_midi()
       if (queue_try_remove(&cynthcart_queue, &cq_entry)) {
         k6850MemRd[RXDR] = cq_entry.data; /* Add data to the RXDR */
         k6850MemRd[STATUS] |= (IRQ|RDRF); /* Set IRQ and RDRF for data available */
-        c64_->cpu_->irq(); /* Trigger CPU IRQ */
+        irq_line(); /* Raise CPU IRQ */
         /* D("[MC6850 READ] $%02X\n",k6850MemRd[RXDR]); */
       }
     }
@@ -218,35 +220,24 @@ inline void MC68B50::process_midi()
 }
 
 /**
- * @brief will check if the cpu IRQ is not set
- * and trigger a cpu IRQ if possible/needed
+ * @brief the CPU IRQ line follows the STATUS IRQ bit
+ * until the data is read from RXDR
  */
-inline void MC68B50::try_trigger_irq()
+void MC68B50::irq_line()
 {
-  if(!c64_->cpu_->idf()) { /* If no CPU IRQ already in place */
-    if (k6850MemRd[STATUS] & IRQ) { /* If IRQ is set */
-      c64_->cpu_->irq(); /* Trigger CPU IRQ */
-    }
-  }
-  return;
+  c64_->cpu_->irq_line(Cpu::kIrqCart, (k6850MemRd[STATUS] & IRQ));
 }
 
 /**
- * @brief emulate triggers a CPU IRQ if no CPU IRW
- * is presently active
+ * @brief emulate processes waiting midi data, the
+ * CPU IRQ line is held while data waits in RXDR
  * Other brands then Datel/Kerberos might require
  * a NMI to trigger, this is not supported yet
  */
 void MC68B50::emulate()
 {
-  /* try trigger IRQ if data waiting */
-  // try_trigger_irq();
-
   /* process midi if waiting in queue */
   process_midi();
 
-   /* try trigger IRQ if data waiting */
-  try_trigger_irq();
-
   return;
 }
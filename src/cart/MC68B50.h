@@ -145,8 +145,8 @@ class MC68B50 : protected MC6850BitMasks
     /* Process Midi data */
     void process_midi();
 
-    /* Trigger CPU IRQ if needed */
-    void try_trigger_irq();
+    /* Drive the CPU IRQ line from STATUS */
+    void irq_line();
 
   public:
     MC68B50(C64 * c64);
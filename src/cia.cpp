@@ -0,0 +1,427 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * cia.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <c64.h> /* All classes are loaded through c64.h */
+#include <snapshot.h>
+
+
+enum CIARegisters
+{
+  PRA     = 0x0, /* Keyboard (R/W), Joystick, Lightpen, Paddles */
+  PRB     = 0x1, /* Keyboard (R/W), Joystick, Timer A, Timer B */
+  DDRA    = 0x2, /* Datadirection Port A */
+  DDRB    = 0x3, /* Datadirection Port B */
+  TAL     = 0x4, /* Timer A Low Byte */
+  TAH     = 0x5, /* Timer A High Byte */
+  TBL     = 0x6, /* Timer B Low Byte */
+  TBH     = 0x7, /* Timer A High Byte */
+  TOD_TEN = 0x8, /* RTC 1/10s */
+  TOD_SEC = 0x9, /* RTC sec */
+  TOD_MIN = 0xA, /* RTC min */
+  TOD_HR  = 0xB, /* RTC hr */
+  SDR     = 0xC, /* Serial shift register */
+  ICR     = 0xD, /* Interrupt control register */
+  CRA     = 0xE, /* Control Timer A */
+  CRB     = 0xF, /* Control Timer B */
+};
+
+enum InterruptBitVal
+{ /* (Read or Write operation determines which one:) */
+  INTERRUPT_HAPPENED = 0x80,
+  SET_OR_CLEAR_FLAGS = 0x80,
+  /* flags/masks of interrupt-sources */
+  FLAGn      = 0x10,
+  SERIALPORT = 0x08,
+  ALARM      = 0x04,
+  TIMERB     = 0x02,
+  TIMERA     = 0x01
+};
+
+enum ControlAbitVal
+{
+  ENABLE_TIMERA        = 0x01,
+  PORTB6_TIMERA        = 0x02,
+  TOGGLED_PORTB6       = 0x04,
+  ONESHOT_TIMERA       = 0x08,
+  FORCELOADA_STROBE    = 0x10,
+  TIMERA_FROM_CNT      = 0x20,
+  SERIALPORT_IS_OUTPUT = 0x40,
+  TIMEOFDAY_50Hz       = 0x80
+};
+
+enum ControlBbitVal
+{
+  ENABLE_TIMERB              = 0x01,
+  PORTB7_TIMERB              = 0x02,
+  TOGGLED_PORTB7             = 0x04,
+  ONESHOT_TIMERB             = 0x08,
+  FORCELOADB_STROBE          = 0x10,
+  TIMERB_FROM_CPUCLK         = 0x00,
+  TIMERB_FROM_CNT            = 0x20,
+  TIMERB_FROM_TIMERA         = 0x40,
+  TIMERB_FROM_TIMERA_AND_CNT = 0x60,
+  TIMEOFDAY_WRITE_SETS_ALARM = 0x80
+};
+
+// variant hooks ////////////////////////////////////////////////////////////
+
+void Cia1Variant::interrupt(C64 *c64, bool asserted)
+{
+  c64->cpu_->irq_line(Cpu::kIrqCia1, asserted);
+}
+
+/**
+ * @brief keyboard matrix
+ * Port A selects the columns, the rows of all selected columns
+ * are returned on both ports, looked up in a table IO keeps
+ * up to date on every key change
+ */
+uint8_t Cia1Variant::read_pra(C64 *c64, const CiaRegs &r)
+{
+  return c64->io_->keyboard_rows(r.pra);
+}
+
+uint8_t Cia1Variant::read_prb(C64 *c64, const CiaRegs &r)
+{
+  return read_pra(c64, r);
+}
+
+void Cia2Variant::interrupt(C64 *c64, bool asserted)
+{
+  c64->cpu_->nmi_line(Cpu::kNmiCia2, asserted);
+}
+
+/* serial pla, RS232, VIC bank */
+uint8_t Cia2Variant::read_pra(C64 *c64, const CiaRegs &r)
+{
+  (void)c64;
+  return (r.pra | ~(r.ddra & 0x3f));
+}
+
+uint8_t Cia2Variant::read_prb(C64 *c64, const CiaRegs &r)
+{
+  (void)c64;
+  return (r.prb & r.ddrb);
+}
+
+// ctor  /////////////////////////////////////////////////////////////////////
+
+template <class Variant>
+Cia<Variant>::Cia(C64 *c64) :
+  c64_(c64)
+{
+  regs_ = CiaRegs();
+  sync_cycles_ = next_event_ = tod_next_ = 0;
+
+  D("[EMU] Cia initialized.\n");
+}
+
+/**
+ * @brief reset registers and timers
+ * Time of day keeps running through a reset
+ */
+template <class Variant>
+void Cia<Variant>::reset()
+{
+  uint8_t tod[4];
+  for (int i = 0; i < 4; i++) tod[i] = regs_.tod[i];
+  regs_ = CiaRegs();
+  for (int i = 0; i < 4; i++) regs_.tod[i] = tod[i];
+
+  unsigned int now = c64_->cpu_->cycles();
+  regs_.ta.reset(0, 0, now);
+  regs_.tb.reset(0, 0, now);
+  Variant::interrupt(c64_, false);
+  sync_cycles_ = now;
+  tod_next_ = now + kTodCycles;
+  schedule();
+}
+
+#if DESKTOP
+/**
+ * @brief save or restore registers and timer stamps
+ * The stamps are cpu cycles, the cpu clock is restored with them
+ */
+template <class Variant>
+void Cia<Variant>::snapshot(Snapshot &s)
+{
+  s.io(regs_);
+  s.io(sync_cycles_);
+  s.io(next_event_);
+  s.io(tod_next_);
+}
+#endif
+
+// DMA register access  //////////////////////////////////////////////////////
+
+template <class Variant>
+void Cia<Variant>::write_register(uint8_t r, uint8_t v)
+{
+  unsigned int now;
+  switch(r)
+  {
+  /* data ports (0x0, 0x1) and data direction (0x2, 0x3) */
+  case PRA:  regs_.pra  = v; break;
+  case PRB:  regs_.prb  = v; break;
+  case DDRA: regs_.ddra = v; break;
+  case DDRB: regs_.ddrb = v; break;
+  /* timer latches (0x4 ~ 0x7) */
+  case TAL:
+    regs_.ta.latch = ((regs_.ta.latch & 0xff00) | v);
+    break;
+  case TAH:
+    regs_.ta.latch = ((regs_.ta.latch & 0x00ff) | (v << 8));
+    if (!(regs_.cra & ENABLE_TIMERA)) { /* stopped timers load on high byte */
+      now = c64_->cpu_->cycles();
+      update(now);
+      regs_.ta.load(now);
+    }
+    break;
+  case TBL:
+    regs_.tb.latch = ((regs_.tb.latch & 0xff00) | v);
+    break;
+  case TBH:
+    regs_.tb.latch = ((regs_.tb.latch & 0x00ff) | (v << 8));
+    if (!(regs_.crb & ENABLE_TIMERB)) { /* stopped timers load on high byte */
+      now = c64_->cpu_->cycles();
+      update(now);
+      regs_.tb.load(now);
+    }
+    break;
+  /* RTC (0x8 ~ 0xB) */
+  case TOD_TEN:
+  case TOD_SEC:
+  case TOD_MIN:
+  case TOD_HR:
+    regs_.tod[r - TOD_TEN] = v;
+    break;
+  /* shift serial (0xC) */
+  case SDR:
+    regs_.sdr = v;
+    break;
+  /* interrupt control and status (0xD) */
+  case ICR:
+    /**
+     * if bit 7 is set, enable selected mask of
+     * interrupts, else disable them
+     */
+    if (v & SET_OR_CLEAR_FLAGS)
+      regs_.icr_mask |= (v & 0x1F);
+    else
+      regs_.icr_mask &= ~(v & 0x1F);
+    interrupt(0); /* enabling an already latched source interrupts */
+    break;
+  /* control timer a (0xE) */
+  case CRA:
+    now = c64_->cpu_->cycles();
+    update(now);
+    if (v & FORCELOADA_STROBE) regs_.ta.load(now);
+    regs_.ta.start = now;
+    regs_.ta.oneshot = (v & ONESHOT_TIMERA);
+    regs_.ta.running = ((v & (ENABLE_TIMERA|TIMERA_FROM_CNT)) == ENABLE_TIMERA);
+    regs_.cra = (v & ~FORCELOADA_STROBE); /* the strobe bit is never stored */
+    schedule();
+    break;
+  /* control timer b (0xF) */
+  case CRB:
+    now = c64_->cpu_->cycles();
+    update(now);
+    if (v & FORCELOADB_STROBE) regs_.tb.load(now);
+    regs_.tb.start = now;
+    regs_.tb.oneshot = (v & ONESHOT_TIMERB);
+    /* phi2 only, counting cnt needs an input that isn't emulated */
+    regs_.tb.running = ((v & (ENABLE_TIMERB|TIMERB_FROM_TIMERA|TIMERB_FROM_CNT)) == ENABLE_TIMERB);
+    regs_.timer_b_counts_a = (v & TIMERB_FROM_TIMERA);
+    regs_.crb = (v & ~FORCELOADB_STROBE);
+    schedule();
+    break;
+  }
+}
+
+template <class Variant>
+uint8_t Cia<Variant>::read_register(uint8_t r)
+{
+  uint8_t retval = 0;
+
+  switch(r)
+  {
+  /* data ports (0x0, 0x1) and data direction (0x2, 0x3) */
+  case PRA:  retval = Variant::read_pra(c64_, regs_); break;
+  case PRB:  retval = Variant::read_prb(c64_, regs_); break;
+  case DDRA: retval = regs_.ddra; break;
+  case DDRB: retval = regs_.ddrb; break;
+  /* timer counters (0x4 ~ 0x7), derived from the start cycle */
+  case TAL: retval = (regs_.ta.counter(c64_->cpu_->cycles()) & 0xff); break;
+  case TAH: retval = (regs_.ta.counter(c64_->cpu_->cycles()) >> 8); break;
+  case TBL: retval = (regs_.tb.counter(c64_->cpu_->cycles()) & 0xff); break;
+  case TBH: retval = (regs_.tb.counter(c64_->cpu_->cycles()) >> 8); break;
+  /* RTC (0x8 ~ 0xB) */
+  case TOD_TEN:
+  case TOD_SEC:
+  case TOD_MIN:
+  case TOD_HR:
+    retval = regs_.tod[r - TOD_TEN];
+    break;
+  /* shift serial (0xC) */
+  case SDR:
+    retval = regs_.sdr;
+    break;
+  /* interrupt control and status (0xD) */
+  case ICR:
+    /* Reading from ICR clears the read register after reading */
+    retval = regs_.icr;
+    regs_.icr = 0;
+    Variant::interrupt(c64_, false); /* acknowledged */
+    break;
+  /* control timers (0xE, 0xF), start bit follows one-shot stops */
+  case CRA:
+    retval = regs_.cra;
+    break;
+  case CRB:
+    retval = regs_.crb;
+    break;
+  }
+  return retval;
+}
+
+// VIC banking ///////////////////////////////////////////////////////////////
+
+/**
+ * @brief retrieves vic base address
+ *
+ * PRA bits (0..1)
+ *
+ *  %00, 0: Bank 3: $C000-$FFFF, 49152-65535
+ *  %01, 1: Bank 2: $8000-$BFFF, 32768-49151
+ *  %10, 2: Bank 1: $4000-$7FFF, 16384-32767
+ *  %11, 3: Bank 0: $0000-$3FFF, 0-16383 (standard)
+ */
+template <class Variant>
+uint16_t Cia<Variant>::vic_base_address()
+{
+  return ((~regs_.pra&0x3) << 14);
+}
+
+// emulation  ////////////////////////////////////////////////////////////////
+
+template <class Variant>
+bool Cia<Variant>::emulate()
+{
+  unsigned int now = c64_->cpu_->cycles();
+  if ((int)(now - next_event_) < 0) {
+    /* nothing due, unless the cpu clock went back (cpu reset) */
+    if ((int)(now - sync_cycles_) >= 0) return true;
+    rebase(now);
+  }
+  update(now);
+  return true;
+}
+
+/**
+ * @brief bring timers and time of day up to cycle now
+ *
+ * Underflows since the last update are counted at once,
+ * the cpu only looks at the interrupt line between
+ * instructions.
+ */
+template <class Variant>
+void Cia<Variant>::update(unsigned int now)
+{
+  /* timer A, phi2 */
+  unsigned int underflows_a = regs_.ta.sync(now);
+  if (underflows_a != 0) {
+    if (regs_.ta.oneshot) regs_.cra &= ~ENABLE_TIMERA; /* one-shot stops */
+    interrupt(TIMERA);
+  }
+  /* timer B, phi2 or timer A underflows */
+  unsigned int underflows_b = regs_.tb.sync(now);
+  if (regs_.timer_b_counts_a && (regs_.crb & ENABLE_TIMERB)) {
+    underflows_b += regs_.tb.tick(underflows_a);
+  }
+  if (underflows_b != 0) {
+    if (regs_.tb.oneshot) regs_.crb &= ~ENABLE_TIMERB; /* one-shot stops */
+    interrupt(TIMERB);
+  }
+  /* Time of day */
+  while ((int)(now - tod_next_) >= 0) {
+    tod_tick();
+    tod_next_ += kTodCycles;
+  }
+  sync_cycles_ = now;
+  schedule();
+}
+
+/**
+ * @brief set the earliest cycle emulate() has work to do
+ */
+template <class Variant>
+void Cia<Variant>::schedule()
+{
+  next_event_ = tod_next_;
+  if (regs_.ta.running && (int)(regs_.ta.underflow_at() - next_event_) < 0)
+    next_event_ = regs_.ta.underflow_at();
+  if (regs_.tb.running && (int)(regs_.tb.underflow_at() - next_event_) < 0)
+    next_event_ = regs_.tb.underflow_at();
+}
+
+/**
+ * @brief move all cycle stamps after the cpu clock was reset
+ */
+template <class Variant>
+void Cia<Variant>::rebase(unsigned int now)
+{
+  unsigned int delta = (now - sync_cycles_);
+  regs_.ta.start += delta;
+  regs_.tb.start += delta;
+  tod_next_ += delta;
+  sync_cycles_ = now;
+  schedule();
+}
+
+template <class Variant>
+void Cia<Variant>::interrupt(uint8_t source)
+{
+  regs_.icr |= source; /* Set source in read ICR */
+  if ((regs_.icr & regs_.icr_mask & 0x1F) && !(regs_.icr & INTERRUPT_HAPPENED)) {
+    regs_.icr |= INTERRUPT_HAPPENED; /* Set interrupt bit in read ICR */
+    Variant::interrupt(c64_, true); /* held until ICR is read */
+  }
+}
+
+/**
+ * @brief advance time of day by 1/10s
+ */
+template <class Variant>
+void Cia<Variant>::tod_tick()
+{
+  uint8_t *tod = regs_.tod;
+  if(++tod[0] != 9) return;
+  tod[0] = 0;
+  if(++tod[1] != 59) return;
+  tod[1] = 0;
+  if(++tod[2] != 59) return;
+  tod[2] = 0;
+  if((++tod[3] & 0x1F) != 11) return;
+  tod[3] = 0x80; /* wraps into pm */
+}
+
+/* both chips are instantiated here */
+template class Cia<Cia1Variant>;
+template class Cia<Cia2Variant>;
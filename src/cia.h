@@ -0,0 +1,142 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * cia.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_CIA_H
+#define EMUDORE_CIA_H
+
+#include <cstdint>
+
+#include <ciatimer.h>
+
+
+/**
+ * @brief 6526 register state
+ *
+ * Everything the chip holds, kept together so a register
+ * access touches one small block instead of two memory pages.
+ */
+struct CiaRegs
+{
+  uint8_t pra;
+  uint8_t prb;
+  uint8_t ddra;
+  uint8_t ddrb;
+  uint8_t tod[4];   /* 1/10s, seconds, minutes, hours */
+  uint8_t sdr;
+  uint8_t icr_mask; /* enabled interrupt sources (ICR write) */
+  uint8_t icr;      /* latched interrupt sources (ICR read) */
+  uint8_t cra;
+  uint8_t crb;
+  bool timer_b_counts_a;
+  CiaTimer ta;
+  CiaTimer tb;
+};
+
+/**
+ * @brief CIA #1 hooks
+ *
+ * - Memory area : $DC00-$DCFF
+ * - Tasks       : Keyboard, Joystick, Paddles, Datasette, IRQ control
+ */
+struct Cia1Variant
+{
+  static void interrupt(C64 *c64, bool asserted); /* IRQ line */
+  static uint8_t read_pra(C64 *c64, const CiaRegs &r);
+  static uint8_t read_prb(C64 *c64, const CiaRegs &r);
+};
+
+/**
+ * @brief CIA #2 hooks
+ *
+ * - Memory area : $DD00-$DDFF
+ * - Tasks       : Serial pla, RS-232, VIC banking, NMI control
+ */
+struct Cia2Variant
+{
+  static void interrupt(C64 *c64, bool asserted); /* NMI line */
+  static uint8_t read_pra(C64 *c64, const CiaRegs &r);
+  static uint8_t read_prb(C64 *c64, const CiaRegs &r);
+};
+
+/**
+ * @brief MOS 6526 Complex Interface Adapter
+ *
+ * Both CIAs share this implementation, the Variant supplies
+ * the interrupt line and the port reads that differ.
+ */
+template <class Variant>
+class Cia
+{
+  private:
+    C64 *c64_;
+    CiaRegs regs_;
+
+    /* timers are counted from cycle stamps instead of every instruction */
+    unsigned int sync_cycles_; /* cycle timers were last brought up to */
+    unsigned int next_event_;  /* earliest cycle anything is due */
+    unsigned int tod_next_;    /* next 1/10s time of day tick */
+    static const unsigned int kTodCycles = 98524; /* PAL phi2 / 10 */
+
+    void update(unsigned int now);
+    void schedule();
+    void rebase(unsigned int now);
+    void interrupt(uint8_t source);
+    void tod_tick();
+
+  public:
+    Cia(C64 * c64);
+
+    void reset(void);
+    bool emulate();
+
+    void write_register(uint8_t r, uint8_t v);
+    uint8_t read_register(uint8_t r);
+
+    /* direct access for keyboard lines and state hashing */
+    CiaRegs &regs(){return regs_;};
+
+    #if DESKTOP
+    /* boot snapshot */
+    void snapshot(Snapshot &s);
+    #endif
+
+    /* VIC banking, only wired on CIA #2 */
+    uint16_t vic_base_address();
+
+    /* constants */
+    enum kInputMode
+    {
+      kModePHI2,
+      kModeCNT,
+      kModeTimerA,
+      kModeTimerACNT
+    };
+    enum kRunMode
+    {
+      kModeRestart,
+      kModeOneTime
+    };
+};
+
+typedef Cia<Cia1Variant> Cia1;
+typedef Cia<Cia2Variant> Cia2;
+
+
+#endif /* EMUDORE_CIA_H */
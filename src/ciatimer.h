@@ -0,0 +1,119 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * ciatimer.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_CIATIMER_H
+#define EMUDORE_CIATIMER_H
+
+#include <cstdint>
+
+
+/**
+ * @brief 6526 interval timer
+ *
+ * The counter is not decremented every instruction, it is
+ * stored as the value it had at a start cycle. The current
+ * value and the next underflow are derived from that when
+ * needed:
+ *
+ *  counter(now)   value - (now - start)
+ *  underflow_at() start + value + 1
+ *
+ * An underflow reloads the latch, so the period of a
+ * continuous timer is latch + 1 ticks. One-shot timers
+ * reload and stop on their first underflow.
+ *
+ * Cycle values are wrapping cpu cycles, only differences
+ * are used.
+ */
+struct CiaTimer
+{
+  uint16_t latch;
+  uint16_t value;      /* counter value at start */
+  unsigned int start;  /* cpu cycle of value */
+  bool running;        /* counting phi2 cycles */
+  bool oneshot;
+
+  void reset(uint16_t l, uint16_t v, unsigned int now)
+  {
+    latch = l;
+    value = v;
+    start = now;
+    running = oneshot = false;
+  };
+
+  /* counter at cycle now without changing state */
+  uint16_t counter(unsigned int now) const
+  {
+    if (!running) return value;
+    unsigned int e = (now - start);
+    if (e <= value) return (value - e);
+    if (oneshot) return latch;
+    return (latch - ((e - value - 1) % ((unsigned int)latch + 1)));
+  };
+
+  /* cycle of the next underflow, only valid while running */
+  unsigned int underflow_at() const
+  {
+    return (start + value + 1);
+  };
+
+  /**
+   * @brief count down ticks
+   * @return number of underflows
+   */
+  unsigned int tick(unsigned int ticks)
+  {
+    if (ticks <= value) {
+      value -= ticks;
+      return 0;
+    }
+    ticks -= ((unsigned int)value + 1); /* first underflow reloads */
+    if (oneshot) {
+      value = latch;
+      running = false;
+      return 1;
+    }
+    unsigned int period = ((unsigned int)latch + 1);
+    value = (latch - (ticks % period));
+    return (1 + (ticks / period));
+  };
+
+  /**
+   * @brief bring a phi2 timer up to cycle now
+   * @return number of underflows
+   */
+  unsigned int sync(unsigned int now)
+  {
+    if (!running) return 0;
+    unsigned int ticks = (now - start);
+    start = now;
+    return tick(ticks);
+  };
+
+  /* force load or load while stopped */
+  void load(unsigned int now)
+  {
+    value = latch;
+    start = now;
+  };
+};
+
+
+#endif /* EMUDORE_CIATIMER_H */
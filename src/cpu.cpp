@@ -21,10 +21,13 @@
 #include <sstream>
 
 #include <c64.h>
+#include <snapshot.h>
 
 Cpu::Cpu(C64 * c64) :
   c64_(c64)
 {
+  int_lines_ = 0;
+  int_idf_ = false;
   initialize_instruction_table();
   D("[EMU] Cpu initialized.\n");
 }
@@ -48,8 +51,29 @@ void Cpu::reset()
   _flags = 0b0;
   pc(c64_->mem_->read_word(Memory::kAddrResetVector));
   cycles_ = 6;
+  /* source lines are released by the device resets */
+  int_lines_ &= ~kNmiLatch;
+  int_idf_ = idf();
 }
 
+#if DESKTOP
+/**
+ * @brief save or restore registers, clock and interrupt lines
+ */
+void Cpu::snapshot(Snapshot &s)
+{
+  s.io(pc_);
+  s.io(sp_);
+  s.io(a_);
+  s.io(x_);
+  s.io(y_);
+  s.io(_flags);
+  s.io(cycles_);
+  s.io(int_lines_);
+  s.io(int_idf_);
+}
+#endif
+
 /**
  * @brief emulate instruction
  * @return returns false if something goes wrong (e.g. illegal instruction)
@@ -62,6 +86,9 @@ void Cpu::reset()
  */
 bool Cpu::emulate()
 {
+  /* interrupts are only taken at the instruction boundary */
+  if (int_lines_ != 0) interrupt();
+  bool idf_before = idf();
   /* fetch instruction */
   uint8_t insn = fetch_op();
   pb_crossed = false;
@@ -70,6 +97,12 @@ bool Cpu::emulate()
   /* emulate instruction */
   execute_opcode(insn);
   pb_crossed = false;
+  /**
+   * the poll happens before the flag changes on the last cycle,
+   * so CLI, SEI and PLP only count after the next instruction,
+   * RTI restores the flag in time and BRK is an interrupt sequence
+   */
+  int_idf_ = ((insn == 0x40 || insn == 0x00) ? idf() : idf_before);
   return retval;
 }
 
@@ -1296,16 +1329,13 @@ inline void Cpu::xaa(uint8_t v)
  */
 void Cpu::irq()
 {
-  if(!idf())
-  {
-    push(((pc()) >> 8) & 0xff);
-    push(((pc()) & 0xff));
-    /* push flags with bcf cleared */
-    push((flags()&0xef));
-    pc(c64_->mem_->read_word(Memory::kAddrIRQVector));
-    idf(true);
-    tick(7);
-  }
+  push(((pc()) >> 8) & 0xff);
+  push(((pc()) & 0xff));
+  /* push flags with bcf cleared */
+  push((flags()&0xef));
+  pc(c64_->mem_->read_word(Memory::kAddrIRQVector));
+  idf(true);
+  tick(7);
 }
 
 /**
@@ -1318,9 +1348,54 @@ void Cpu::nmi()
   /* push flags with bcf cleared */
   push((flags() & 0xef));
   pc(c64_->mem_->read_word(Memory::kAddrNMIVector));
+  idf(true);
   tick(7);
 }
 
+/**
+ * @brief take a pending interrupt
+ *
+ * NMI wins over IRQ, IRQ is masked by the I flag as
+ * it was when the previous instruction polled.
+ */
+void Cpu::interrupt()
+{
+  if (int_lines_ & kNmiLatch) {
+    int_lines_ &= ~kNmiLatch;
+    nmi();
+  } else if ((int_lines_ & kIrqMask) && !int_idf_) {
+    irq();
+  }
+}
+
+/**
+ * @brief set or release an IRQ source
+ * The IRQ line is level triggered, it stays active
+ * until every source has been acknowledged
+ */
+void Cpu::irq_line(uint8_t source, bool asserted)
+{
+  if (asserted) int_lines_ |= source;
+  else int_lines_ &= ~(uint32_t)source;
+}
+
+/**
+ * @brief set or release an NMI source
+ * The NMI line is edge triggered, only a transition
+ * from no active source to an active source latches
+ * an interrupt
+ */
+void Cpu::nmi_line(uint8_t source, bool asserted)
+{
+  uint32_t s = ((uint32_t)source << 8);
+  if (asserted) {
+    if (!(int_lines_ & kNmiMask)) int_lines_ |= kNmiLatch;
+    int_lines_ |= s;
+  } else {
+    int_lines_ &= ~s;
+  }
+}
+
 // debugging /////////////////////////////////////////////////////////////////
 
 inline void Cpu::dump_flags()
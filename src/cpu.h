@@ -95,6 +95,20 @@ class Cpu
     C64 *c64_;
     static unsigned int cycles_;
 
+    /**
+     * interrupt lines, one word polled per instruction
+     *
+     *  bits  0-7  irq sources (level, wired or)
+     *  bits  8-15 nmi sources (level, wired or)
+     *  bit  16    nmi edge latch
+     */
+    uint32_t int_lines_;
+    bool int_idf_; /* I flag as seen by the interrupt poll */
+    static constexpr uint32_t kIrqMask  = 0x000000ff;
+    static constexpr uint32_t kNmiMask  = 0x0000ff00;
+    static constexpr uint32_t kNmiLatch = 0x00010000;
+    void interrupt();
+
     /* helpers */
     uint16_t curr_page; /* current page at start of cpu emulation */
     bool pb_crossed;    /* true if page boundary crossed */
@@ -252,9 +266,26 @@ class Cpu
     unsigned int cycles(){return cycles_;};
     void cycles(unsigned int v){cycles_=v;};
 
+    #if DESKTOP
+    /* boot snapshot */
+    void snapshot(Snapshot &s);
+    #endif
+
     /* interrupts */
     void nmi();
     void irq();
+    void irq_line(uint8_t source, bool asserted);
+    void nmi_line(uint8_t source, bool asserted);
+    enum kIrqSource
+    {
+      kIrqVic  = (1<<0),
+      kIrqCia1 = (1<<1),
+      kIrqCart = (1<<2),
+    };
+    enum kNmiSource
+    {
+      kNmiCia2 = (1<<0),
+    };
 
     /* debug */
     static bool loginstructions;
@@ -18,10 +18,16 @@
  * limitations under the License.
  */
 
-#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#if DESKTOP
+#include <time.h>
+#include <errno.h>
+#endif
 
 #include <c64.h>
 #include <io.h>
+#include <capture.h>
 
 #if EMBEDDED
 extern "C" uint16_t cycled_delay_operation(uint16_t cycles);
@@ -37,19 +43,34 @@ bool IO::shiftlock = false;
 /* Disk drive */
 bool IO::diskpresent = false;
 
+/* Video capture */
+std::string IO::capture_file = "";
+unsigned int IO::capture_frames = 0;
+
+/* Frame pacing */
+bool IO::log_frametimes = false;
+bool IO::display_lock = false;
+bool IO::pacing = true;
+
 IO::IO(C64 *c64,bool sdl) :
   c64_(c64),
   nosdl(sdl)
 {
+  cols_ = Vic::kVisibleScreenWidth;
+  rows_ = Vic::kVisibleScreenHeight;
   #if DESKTOP
-  // printf("sdl: %d %d\n",sdl,nosdl);
   #if SDL_ENABLED
+  /**
+   * the window is created and its events are pumped on this (the
+   * main) thread, renderer and texture live on the presentation
+   * thread, which only uploads and presents frames
+   */
   if(!nosdl) {
     SDL_Init(SDL_INIT_VIDEO);
     /**
-    * We create the window double the original pixel size,
-    * the renderer takes care of upscaling
-    */
+     * We create the window double the original pixel size,
+     * the renderer takes care of upscaling
+     */
     window_ = SDL_CreateWindow(
           "emudore",
           SDL_WINDOWPOS_UNDEFINED,
@@ -58,43 +79,82 @@ IO::IO(C64 *c64,bool sdl) :
           Vic::kVisibleScreenHeight * 2,
           SDL_WINDOW_OPENGL
     );
-  }
-  #endif
-  #endif /* DESKTOP */
-  cols_ = Vic::kVisibleScreenWidth;
-  rows_ = Vic::kVisibleScreenHeight;
-  /* use a single texture and hardware acceleration */
-  #if DESKTOP
-  #if SDL_ENABLED
-  if(!nosdl) {
-    renderer_ = SDL_CreateRenderer(window_, -1, SDL_RENDERER_ACCELERATED);
-    texture_  = SDL_CreateTexture(renderer_,
-                                  SDL_PIXELFORMAT_ARGB8888,
-                                  SDL_TEXTUREACCESS_STREAMING,
-                                  cols_,
-                                  rows_);
     format_ = SDL_AllocFormat(SDL_PIXELFORMAT_ARGB8888);
-    }
+  }
   #endif
-  #endif /* DESKTOP */
   /**
    * unfortunately, we need to keep a copy of the rendered frame
    * in our own memory, there does not seem to be a way around
    * that would allow manipulating pixels straight on the GPU
    * memory due to how the image is internally stored, etc..
    *
-   * The rendered frame gets uploaded to the GPU on every
-   * screen refresh.
+   * Frames are triple buffered, only lines that changed since
+   * the last presented frame get uploaded to the GPU.
    */
-  #if DESKTOP
-  frame_  = new uint32_t[cols_ * rows_]();
-  #endif
+  for(int i = 0 ; i < 3 ; i++)
+  {
+    frames_[i] = new uint32_t[cols_ * rows_]();
+  }
+  back_frame_ = 0;
+  ready_frame_.store(1);
+  frame_ = frames_[back_frame_];
+  #endif /* DESKTOP */
   init_color_palette();
   init_keyboard();
   #if DESKTOP
   next_key_event_at_ = 0;
+  /* capture format follows the file extension */
+  capture_ = nullptr;
+  captured_ = 0;
+  if(!capture_file.empty()) {
+    size_t ext_i = capture_file.find_last_of(".");
+    bool y4m = (ext_i != std::string::npos &&
+                capture_file.substr(ext_i + 1) == "y4m");
+    capture_ = new VideoCapture(capture_file,
+      (y4m ? VideoCapture::kY4M : VideoCapture::kRaw),
+      cols_, rows_, color_palette);
+  }
   #endif
+  frame_load_ = 0.0;
   prev_frame_was_at_ = std::chrono::high_resolution_clock::now();
+  #if DESKTOP
+  pace_resync_ = true;
+  pace_prev_cycles_ = 0;
+  pace_cycles_ = 0;
+  stat_frames_ = stat_late_ = 0;
+  stat_prev_frame_ = std::chrono::steady_clock::now();
+  #endif
+  #if DESKTOP && SDL_ENABLED
+  display_locked_.store(false);
+  key_events_dropped_ = 0;
+  memset(key_pressed_at_, 0, sizeof(key_pressed_at_));
+  memset(key_pressed_stamp_, 0, sizeof(key_pressed_stamp_));
+  vblanks_.store(0);
+  last_vblank_ = 0;
+  expose_.store(false);
+  present_running_.store(false);
+  if(!nosdl) {
+    /* lock to the display only if it refreshes at (about) PAL rate */
+    if(display_lock) {
+      SDL_DisplayMode mode;
+      if(SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window_), &mode) == 0 &&
+         mode.refresh_rate >= 49 && mode.refresh_rate <= 51) {
+        display_locked_.store(true);
+      } else {
+        printf("[IO] Display is not running at 50Hz, using timer based frame pacing\n");
+      }
+    }
+    front_frame_ = 2;
+    shadow_ = new uint32_t[cols_ * rows_]();
+    redraw_ = true;
+    present_running_.store(true);
+    int error = pthread_create(&present_threadid_, NULL, &_Present_Thread, this);
+    if (error != 0) {
+      fprintf(stderr, "[IO] Present thread can't be created :[%s]\n", strerror(error));
+      present_running_.store(false);
+    }
+  }
+  #endif
 
   D("[EMU] IO initialized.\n");
 }
@@ -102,15 +162,24 @@ IO::IO(C64 *c64,bool sdl) :
 IO::~IO()
 {
   #if DESKTOP
-  delete [] frame_;
   #if SDL_ENABLED
   if(!nosdl) {
-    SDL_DestroyRenderer(renderer_);
-    SDL_DestroyTexture(texture_);
+    if(present_running_.exchange(false)) {
+      pthread_join(present_threadid_, NULL);
+    }
+    delete [] shadow_;
     SDL_FreeFormat(format_);
+    SDL_DestroyWindow(window_);
     SDL_Quit();
+    if(key_events_dropped_ != 0)
+      fprintf(stderr, "[IO] %lu key presses dropped, input queue full\n", key_events_dropped_);
   }
   #endif
+  if(capture_ != nullptr) delete capture_;
+  for(int i = 0 ; i < 3 ; i++)
+  {
+    delete [] frames_[i];
+  }
   #endif /* DESKTOP */
 }
 
@@ -118,6 +187,7 @@ void IO::reset()
 {
   #if DESKTOP
   next_key_event_at_ = 0;
+  pace_resync_ = true;
   #endif
   prev_frame_was_at_ = std::chrono::high_resolution_clock::now();
 }
@@ -134,164 +204,194 @@ void IO::init_keyboard()
   {
     keyboard_matrix_[i] = 0xff;
   }
+  update_keyboard_rows();
   /* character to sdl key map */
   #if DESKTOP
-  charmap_['A']  = {SDL_SCANCODE_A};
-  charmap_['B']  = {SDL_SCANCODE_B};
-  charmap_['C']  = {SDL_SCANCODE_C};
-  charmap_['D']  = {SDL_SCANCODE_D};
-  charmap_['E']  = {SDL_SCANCODE_E};
-  charmap_['F']  = {SDL_SCANCODE_F};
-  charmap_['G']  = {SDL_SCANCODE_G};
-  charmap_['H']  = {SDL_SCANCODE_H};
-  charmap_['I']  = {SDL_SCANCODE_I};
-  charmap_['J']  = {SDL_SCANCODE_J};
-  charmap_['K']  = {SDL_SCANCODE_K};
-  charmap_['L']  = {SDL_SCANCODE_L};
-  charmap_['M']  = {SDL_SCANCODE_M};
-  charmap_['N']  = {SDL_SCANCODE_N};
-  charmap_['O']  = {SDL_SCANCODE_O};
-  charmap_['P']  = {SDL_SCANCODE_P};
-  charmap_['Q']  = {SDL_SCANCODE_Q};
-  charmap_['R']  = {SDL_SCANCODE_R};
-  charmap_['S']  = {SDL_SCANCODE_S};
-  charmap_['T']  = {SDL_SCANCODE_T};
-  charmap_['U']  = {SDL_SCANCODE_U};
-  charmap_['V']  = {SDL_SCANCODE_V};
-  charmap_['W']  = {SDL_SCANCODE_W};
-  charmap_['X']  = {SDL_SCANCODE_X};
-  charmap_['Y']  = {SDL_SCANCODE_Y};
-  charmap_['Z']  = {SDL_SCANCODE_Z};
-  charmap_['1']  = {SDL_SCANCODE_1};
-  charmap_['2']  = {SDL_SCANCODE_2};
-  charmap_['3']  = {SDL_SCANCODE_3};
-  charmap_['4']  = {SDL_SCANCODE_4};
-  charmap_['5']  = {SDL_SCANCODE_5};
-  charmap_['6']  = {SDL_SCANCODE_6};
-  charmap_['7']  = {SDL_SCANCODE_7};
-  charmap_['8']  = {SDL_SCANCODE_8};
-  charmap_['9']  = {SDL_SCANCODE_9};
-  charmap_['0']  = {SDL_SCANCODE_0};
-  charmap_['\n'] = {SDL_SCANCODE_RETURN};
-  charmap_[' ']  = {SDL_SCANCODE_SPACE};
-  charmap_[',']  = {SDL_SCANCODE_COMMA};
-  charmap_['.']  = {SDL_SCANCODE_PERIOD};
-  charmap_['/']  = {SDL_SCANCODE_SLASH};
-  charmap_[';']  = {SDL_SCANCODE_SEMICOLON};
-  charmap_['=']  = {SDL_SCANCODE_EQUALS};
-  charmap_['-']  = {SDL_SCANCODE_MINUS};
-  charmap_[':']  = {SDL_SCANCODE_BACKSLASH};
-  charmap_['+']  = {SDL_SCANCODE_LEFTBRACKET};
-  charmap_['*']  = {SDL_SCANCODE_RIGHTBRACKET};
-  charmap_['@']  = {SDL_SCANCODE_APOSTROPHE};
-  charmap_['(']  = {SDL_SCANCODE_LSHIFT,SDL_SCANCODE_8};
-  charmap_[')']  = {SDL_SCANCODE_LSHIFT,SDL_SCANCODE_9};
-  charmap_['<']  = {SDL_SCANCODE_LSHIFT,SDL_SCANCODE_COMMA};
-  charmap_['>']  = {SDL_SCANCODE_LSHIFT,SDL_SCANCODE_PERIOD};
-  charmap_['"']  = {SDL_SCANCODE_LSHIFT,SDL_SCANCODE_2};
-  charmap_['$']  = {SDL_SCANCODE_LSHIFT,SDL_SCANCODE_4};
+  memset(charmap_, 0, sizeof(charmap_));
+  memset(keymap_, kNoKey, sizeof(keymap_));
+  map_char('A',  SDL_SCANCODE_A);
+  map_char('B',  SDL_SCANCODE_B);
+  map_char('C',  SDL_SCANCODE_C);
+  map_char('D',  SDL_SCANCODE_D);
+  map_char('E',  SDL_SCANCODE_E);
+  map_char('F',  SDL_SCANCODE_F);
+  map_char('G',  SDL_SCANCODE_G);
+  map_char('H',  SDL_SCANCODE_H);
+  map_char('I',  SDL_SCANCODE_I);
+  map_char('J',  SDL_SCANCODE_J);
+  map_char('K',  SDL_SCANCODE_K);
+  map_char('L',  SDL_SCANCODE_L);
+  map_char('M',  SDL_SCANCODE_M);
+  map_char('N',  SDL_SCANCODE_N);
+  map_char('O',  SDL_SCANCODE_O);
+  map_char('P',  SDL_SCANCODE_P);
+  map_char('Q',  SDL_SCANCODE_Q);
+  map_char('R',  SDL_SCANCODE_R);
+  map_char('S',  SDL_SCANCODE_S);
+  map_char('T',  SDL_SCANCODE_T);
+  map_char('U',  SDL_SCANCODE_U);
+  map_char('V',  SDL_SCANCODE_V);
+  map_char('W',  SDL_SCANCODE_W);
+  map_char('X',  SDL_SCANCODE_X);
+  map_char('Y',  SDL_SCANCODE_Y);
+  map_char('Z',  SDL_SCANCODE_Z);
+  map_char('1',  SDL_SCANCODE_1);
+  map_char('2',  SDL_SCANCODE_2);
+  map_char('3',  SDL_SCANCODE_3);
+  map_char('4',  SDL_SCANCODE_4);
+  map_char('5',  SDL_SCANCODE_5);
+  map_char('6',  SDL_SCANCODE_6);
+  map_char('7',  SDL_SCANCODE_7);
+  map_char('8',  SDL_SCANCODE_8);
+  map_char('9',  SDL_SCANCODE_9);
+  map_char('0',  SDL_SCANCODE_0);
+  map_char('\n', SDL_SCANCODE_RETURN);
+  map_char(' ',  SDL_SCANCODE_SPACE);
+  map_char(',',  SDL_SCANCODE_COMMA);
+  map_char('.',  SDL_SCANCODE_PERIOD);
+  map_char('/',  SDL_SCANCODE_SLASH);
+  map_char(';',  SDL_SCANCODE_SEMICOLON);
+  map_char('=',  SDL_SCANCODE_EQUALS);
+  map_char('-',  SDL_SCANCODE_MINUS);
+  map_char(':',  SDL_SCANCODE_BACKSLASH);
+  map_char('+',  SDL_SCANCODE_LEFTBRACKET);
+  map_char('*',  SDL_SCANCODE_RIGHTBRACKET);
+  map_char('@',  SDL_SCANCODE_APOSTROPHE);
+  map_char('(',  SDL_SCANCODE_8, true);
+  map_char(')',  SDL_SCANCODE_9, true);
+  map_char('<',  SDL_SCANCODE_COMMA, true);
+  map_char('>',  SDL_SCANCODE_PERIOD, true);
+  map_char('"',  SDL_SCANCODE_2, true);
+  map_char('$',  SDL_SCANCODE_4, true);
   /* keymap letters */
-  keymap_[SDL_SCANCODE_A] = std::make_pair(1,2);
-  keymap_[SDL_SCANCODE_B] = std::make_pair(3,4);
-  keymap_[SDL_SCANCODE_C] = std::make_pair(2,4);
-  keymap_[SDL_SCANCODE_D] = std::make_pair(2,2);
-  keymap_[SDL_SCANCODE_E] = std::make_pair(1,6);
-  keymap_[SDL_SCANCODE_F] = std::make_pair(2,5);
-  keymap_[SDL_SCANCODE_G] = std::make_pair(3,2);
-  keymap_[SDL_SCANCODE_H] = std::make_pair(3,5);
-  keymap_[SDL_SCANCODE_I] = std::make_pair(4,1);
-  keymap_[SDL_SCANCODE_J] = std::make_pair(4,2);
-  keymap_[SDL_SCANCODE_K] = std::make_pair(4,5);
-  keymap_[SDL_SCANCODE_L] = std::make_pair(5,2);
-  keymap_[SDL_SCANCODE_M] = std::make_pair(4,4);
-  keymap_[SDL_SCANCODE_N] = std::make_pair(4,7);
-  keymap_[SDL_SCANCODE_O] = std::make_pair(4,6);
-  keymap_[SDL_SCANCODE_P] = std::make_pair(5,1);
-  keymap_[SDL_SCANCODE_Q] = std::make_pair(7,6);
-  keymap_[SDL_SCANCODE_R] = std::make_pair(2,1);
-  keymap_[SDL_SCANCODE_S] = std::make_pair(1,5);
-  keymap_[SDL_SCANCODE_T] = std::make_pair(2,6);
-  keymap_[SDL_SCANCODE_U] = std::make_pair(3,6);
-  keymap_[SDL_SCANCODE_V] = std::make_pair(3,7);
-  keymap_[SDL_SCANCODE_W] = std::make_pair(1,1);
-  keymap_[SDL_SCANCODE_X] = std::make_pair(2,7);
-  keymap_[SDL_SCANCODE_Y] = std::make_pair(3,1);
-  keymap_[SDL_SCANCODE_Z] = std::make_pair(1,4);
+  map_key(SDL_SCANCODE_A, 1,2);
+  map_key(SDL_SCANCODE_B, 3,4);
+  map_key(SDL_SCANCODE_C, 2,4);
+  map_key(SDL_SCANCODE_D, 2,2);
+  map_key(SDL_SCANCODE_E, 1,6);
+  map_key(SDL_SCANCODE_F, 2,5);
+  map_key(SDL_SCANCODE_G, 3,2);
+  map_key(SDL_SCANCODE_H, 3,5);
+  map_key(SDL_SCANCODE_I, 4,1);
+  map_key(SDL_SCANCODE_J, 4,2);
+  map_key(SDL_SCANCODE_K, 4,5);
+  map_key(SDL_SCANCODE_L, 5,2);
+  map_key(SDL_SCANCODE_M, 4,4);
+  map_key(SDL_SCANCODE_N, 4,7);
+  map_key(SDL_SCANCODE_O, 4,6);
+  map_key(SDL_SCANCODE_P, 5,1);
+  map_key(SDL_SCANCODE_Q, 7,6);
+  map_key(SDL_SCANCODE_R, 2,1);
+  map_key(SDL_SCANCODE_S, 1,5);
+  map_key(SDL_SCANCODE_T, 2,6);
+  map_key(SDL_SCANCODE_U, 3,6);
+  map_key(SDL_SCANCODE_V, 3,7);
+  map_key(SDL_SCANCODE_W, 1,1);
+  map_key(SDL_SCANCODE_X, 2,7);
+  map_key(SDL_SCANCODE_Y, 3,1);
+  map_key(SDL_SCANCODE_Z, 1,4);
   /* keymap numbers */
-  keymap_[SDL_SCANCODE_1] = std::make_pair(7,0);
-  keymap_[SDL_SCANCODE_2] = std::make_pair(7,3);
-  keymap_[SDL_SCANCODE_3] = std::make_pair(1,0);
-  keymap_[SDL_SCANCODE_4] = std::make_pair(1,3);
-  keymap_[SDL_SCANCODE_5] = std::make_pair(2,0);
-  keymap_[SDL_SCANCODE_6] = std::make_pair(2,3);
-  keymap_[SDL_SCANCODE_7] = std::make_pair(3,0);
-  keymap_[SDL_SCANCODE_8] = std::make_pair(3,3);
-  keymap_[SDL_SCANCODE_9] = std::make_pair(4,0);
-  keymap_[SDL_SCANCODE_0] = std::make_pair(4,3);
+  map_key(SDL_SCANCODE_1, 7,0);
+  map_key(SDL_SCANCODE_2, 7,3);
+  map_key(SDL_SCANCODE_3, 1,0);
+  map_key(SDL_SCANCODE_4, 1,3);
+  map_key(SDL_SCANCODE_5, 2,0);
+  map_key(SDL_SCANCODE_6, 2,3);
+  map_key(SDL_SCANCODE_7, 3,0);
+  map_key(SDL_SCANCODE_8, 3,3);
+  map_key(SDL_SCANCODE_9, 4,0);
+  map_key(SDL_SCANCODE_0, 4,3);
   /* keymap function keys */
-  keymap_[SDL_SCANCODE_F1] = std::make_pair(0,4);
-  keymap_[SDL_SCANCODE_F3] = std::make_pair(0,5);
-  keymap_[SDL_SCANCODE_F5] = std::make_pair(0,6);
-  keymap_[SDL_SCANCODE_F7] = std::make_pair(0,3);
+  map_key(SDL_SCANCODE_F1, 0,4);
+  map_key(SDL_SCANCODE_F3, 0,5);
+  map_key(SDL_SCANCODE_F5, 0,6);
+  map_key(SDL_SCANCODE_F7, 0,3);
   /* keymap: other */
-  keymap_[SDL_SCANCODE_RETURN]    = std::make_pair(0,1);
-  keymap_[SDL_SCANCODE_SPACE]     = std::make_pair(7,4);
-  keymap_[SDL_SCANCODE_LSHIFT]    = std::make_pair(1,7);
-  keymap_[SDL_SCANCODE_RSHIFT]    = std::make_pair(6,4);
-  keymap_[SDL_SCANCODE_COMMA]     = std::make_pair(5,7);
-  keymap_[SDL_SCANCODE_PERIOD]    = std::make_pair(5,4);
-  keymap_[SDL_SCANCODE_SLASH]     = std::make_pair(6,7);
-  keymap_[SDL_SCANCODE_SEMICOLON] = std::make_pair(6,2);
-  keymap_[SDL_SCANCODE_EQUALS]    = std::make_pair(6,5);
-  keymap_[SDL_SCANCODE_BACKSPACE] = std::make_pair(0,0);
-  keymap_[SDL_SCANCODE_MINUS]     = std::make_pair(5,3);
+  map_key(SDL_SCANCODE_RETURN,    0,1);
+  map_key(SDL_SCANCODE_SPACE,     7,4);
+  map_key(SDL_SCANCODE_LSHIFT,    1,7);
+  map_key(SDL_SCANCODE_RSHIFT,    6,4);
+  map_key(SDL_SCANCODE_COMMA,     5,7);
+  map_key(SDL_SCANCODE_PERIOD,    5,4);
+  map_key(SDL_SCANCODE_SLASH,     6,7);
+  map_key(SDL_SCANCODE_SEMICOLON, 6,2);
+  map_key(SDL_SCANCODE_EQUALS,    6,5);
+  map_key(SDL_SCANCODE_BACKSPACE, 0,0);
+  map_key(SDL_SCANCODE_MINUS,     5,3);
   /* CRSR */
-  keymap_[SDL_SCANCODE_UP]        = std::make_pair(0,7); // needs auto shift
-  keymap_[SDL_SCANCODE_DOWN]      = std::make_pair(0,7);
-  keymap_[SDL_SCANCODE_LEFT]      = std::make_pair(0,2); // needs auto shift
-  keymap_[SDL_SCANCODE_RIGHT]     = std::make_pair(0,2);
+  map_key(SDL_SCANCODE_UP,        0,7); // needs auto shift
+  map_key(SDL_SCANCODE_DOWN,      0,7);
+  map_key(SDL_SCANCODE_LEFT,      0,2); // needs auto shift
+  map_key(SDL_SCANCODE_RIGHT,     0,2);
   /* keymap: these are mapped to other keys */
-  keymap_[SDL_SCANCODE_HOME]         = std::make_pair(6,3); // CLR
-  keymap_[SDL_SCANCODE_BACKSLASH]    = std::make_pair(5,5); // :
-  keymap_[SDL_SCANCODE_LEFTBRACKET]  = std::make_pair(5,0); // +
-  keymap_[SDL_SCANCODE_RIGHTBRACKET] = std::make_pair(6,1); // *
-  keymap_[SDL_SCANCODE_APOSTROPHE]   = std::make_pair(5,6); // @
-  keymap_[SDL_SCANCODE_LGUI]         = std::make_pair(7,5); // (Win/Cmd) CBM / commodore key
-  keymap_[SDL_SCANCODE_LCTRL]        = std::make_pair(7,2); // CTRL
-  keymap_[SDL_SCANCODE_RCTRL]        = std::make_pair(7,2); // CTRL
-  keymap_[SDL_SCANCODE_LALT]         = std::make_pair(7,2); // CTRL
-  keymap_[SDL_SCANCODE_RALT]         = std::make_pair(7,2); // CTRL
-  keymap_[SDL_SCANCODE_ESCAPE]       = std::make_pair(7,7); // RUN/STOP
-  keymap_[SDL_SCANCODE_PAGEUP]       = std::make_pair(7,5); // RESTORE
+  map_key(SDL_SCANCODE_HOME,         6,3); // CLR
+  map_key(SDL_SCANCODE_BACKSLASH,    5,5); // :
+  map_key(SDL_SCANCODE_LEFTBRACKET,  5,0); // +
+  map_key(SDL_SCANCODE_RIGHTBRACKET, 6,1); // *
+  map_key(SDL_SCANCODE_APOSTROPHE,   5,6); // @
+  map_key(SDL_SCANCODE_LGUI,         7,5); // (Win/Cmd) CBM / commodore key
+  map_key(SDL_SCANCODE_LCTRL,        7,2); // CTRL
+  map_key(SDL_SCANCODE_RCTRL,        7,2); // CTRL
+  map_key(SDL_SCANCODE_LALT,         7,2); // CTRL
+  map_key(SDL_SCANCODE_RALT,         7,2); // CTRL
+  map_key(SDL_SCANCODE_ESCAPE,       7,7); // RUN/STOP
+  map_key(SDL_SCANCODE_PAGEUP,       7,5); // RESTORE
   #endif /* DESKTOP */
 }
 
+/**
+ * @brief rebuild the column select to rows table
+ *
+ * Every column pulled low by PRA drives its rows onto PRB,
+ * so the result is the AND of all selected matrix columns.
+ * Each entry is the previous entry without its lowest
+ * selected column, ANDed with that column.
+ */
+void IO::update_keyboard_rows()
+{
+  keyboard_rows_[0xff] = 0xff;
+  for(int s = 0xfe ; s >= 0 ; s--)
+  {
+    int c = __builtin_ctz(~s);
+    keyboard_rows_[s] = (keyboard_matrix_[c] & keyboard_rows_[s | (1 << c)]);
+  }
+}
+
 /**
  * @brief init c64 color palette
  */
 void IO::init_color_palette()
 {
   #if DESKTOP
-  #if SDL_ENABLED
-  if(!nosdl) {
-    color_palette[0]   = SDL_MapRGB(format_, 0x00, 0x00, 0x00);
-    color_palette[1]   = SDL_MapRGB(format_, 0xff, 0xff, 0xff);
-    color_palette[2]   = SDL_MapRGB(format_, 0xab, 0x31, 0x26);
-    color_palette[3]   = SDL_MapRGB(format_, 0x66, 0xda, 0xff);
-    color_palette[4]   = SDL_MapRGB(format_, 0xbb, 0x3f, 0xb8);
-    color_palette[5]   = SDL_MapRGB(format_, 0x55, 0xce, 0x58);
-    color_palette[6]   = SDL_MapRGB(format_, 0x1d, 0x0e, 0x97);
-    color_palette[7]   = SDL_MapRGB(format_, 0xea, 0xf5, 0x7c);
-    color_palette[8]   = SDL_MapRGB(format_, 0xb9, 0x74, 0x18);
-    color_palette[9]   = SDL_MapRGB(format_, 0x78, 0x53, 0x00);
-    color_palette[10]  = SDL_MapRGB(format_, 0xdd, 0x93, 0x87);
-    color_palette[11]  = SDL_MapRGB(format_, 0x5b, 0x5b, 0x5b);
-    color_palette[12]  = SDL_MapRGB(format_, 0x8b, 0x8b, 0x8b);
-    color_palette[13]  = SDL_MapRGB(format_, 0xb0, 0xf4, 0xac);
-    color_palette[14]  = SDL_MapRGB(format_, 0xaa, 0x9d, 0xef);
-    color_palette[15]  = SDL_MapRGB(format_, 0xb8, 0xb8, 0xb8);
+  static const uint8_t rgb[16][3] = {
+    {0x00, 0x00, 0x00},
+    {0xff, 0xff, 0xff},
+    {0xab, 0x31, 0x26},
+    {0x66, 0xda, 0xff},
+    {0xbb, 0x3f, 0xb8},
+    {0x55, 0xce, 0x58},
+    {0x1d, 0x0e, 0x97},
+    {0xea, 0xf5, 0x7c},
+    {0xb9, 0x74, 0x18},
+    {0x78, 0x53, 0x00},
+    {0xdd, 0x93, 0x87},
+    {0x5b, 0x5b, 0x5b},
+    {0x8b, 0x8b, 0x8b},
+    {0xb0, 0xf4, 0xac},
+    {0xaa, 0x9d, 0xef},
+    {0xb8, 0xb8, 0xb8},
+  };
+  for(int i = 0 ; i < 16 ; i++)
+  {
+    #if SDL_ENABLED
+    if(!nosdl) {
+      color_palette[i] = SDL_MapRGB(format_, rgb[i][0], rgb[i][1], rgb[i][2]);
+      continue;
+    }
+    #endif
+    /* ARGB8888 without SDL (-cli), used for capturing */
+    color_palette[i] = (0xff000000 | (rgb[i][0] << 16) | (rgb[i][1] << 8) | rgb[i][2]);
   }
-  #endif
   #endif /* DESKTOP */
 }
 
@@ -308,24 +408,25 @@ void IO::process_events()
   #if DESKTOP
   #if SDL_ENABLED
   if(!nosdl) {
-    SDL_Event event;
-    while(SDL_PollEvent(&event))
+    /**
+     * key events gathered by pump_events(), a release keeps the key
+     * down for as long as the host held that key, but at least one
+     * frame so short taps reach the keyboard scan
+     */
+    unsigned int now = c64_->cpu_->cycles();
+    KeyEvent *ev;
+    while((ev = sdl_key_events_.front()) != nullptr)
     {
-      switch(event.type)
-      {
-      case SDL_KEYDOWN:
-        handle_keydown(event.key.keysym.scancode);
-        break;
-      case SDL_KEYUP:
-        handle_keyup(event.key.keysym.scancode);
-        break;
-      case SDL_QUIT:
-        retval_ = false;
-        break;
-      }
+      if(!apply_key_event(*ev, now)) break;
+      sdl_key_events_.pop();
     }
   }
   #endif /* SDL_ENABLED */
+  /* refill the keyboard buffer when the KERNAL is about to read it */
+  if(!inject_queue_.empty()) {
+    uint16_t pc = c64_->cpu_->pc();
+    if(pc == kAddrKernalGetin || pc == kAddrKernalInput) inject_refill();
+  }
   /* process fake keystrokes if any */
   if(!key_event_queue_.empty() &&
      c64_->cpu_->cycles() > next_key_event_at_)
@@ -346,6 +447,87 @@ void IO::process_events()
   #endif /* DESKTOP */
 }
 
+#if DESKTOP && SDL_ENABLED
+/**
+ * @brief pump SDL events, once per frame on the main thread
+ *
+ * Key events are queued with the cycle they were seen at and
+ * applied by process_events().
+ */
+void IO::pump_events()
+{
+  SDL_Event event;
+  while(SDL_PollEvent(&event))
+  {
+    switch(event.type)
+    {
+    case SDL_KEYDOWN:
+      if(event.key.repeat) break; /* the c64 repeats by itself */
+      queue_key_event(kPress, (SDL_Keycode)event.key.keysym.scancode);
+      break;
+    case SDL_KEYUP:
+      queue_key_event(kRelease, (SDL_Keycode)event.key.keysym.scancode);
+      break;
+    case SDL_WINDOWEVENT:
+      expose_.store(true, std::memory_order_relaxed);
+      break;
+    case SDL_QUIT:
+      retval_ = false;
+      break;
+    }
+  }
+}
+
+/**
+ * @brief queue a host key event
+ *
+ * A press that doesn't fit is dropped and counted. A release
+ * never is, the key would stay down: the oldest events are
+ * applied right away, ahead of their hold time, to make room.
+ */
+void IO::queue_key_event(kKeyEvent type, SDL_Keycode k)
+{
+  unsigned int now = c64_->cpu_->cycles();
+  KeyEvent ev = {type, k, now};
+  if(sdl_key_events_.push(ev)) return;
+  if(type == kPress) {
+    key_events_dropped_++;
+    return;
+  }
+  KeyEvent *head;
+  while(!sdl_key_events_.push(ev) && (head = sdl_key_events_.front()) != nullptr)
+  {
+    apply_key_event(*head, now, true);
+    sdl_key_events_.pop();
+  }
+}
+
+/**
+ * @brief apply a queued key event
+ * @return false for a release that isn't due yet, unless early
+ */
+bool IO::apply_key_event(const KeyEvent &ev, unsigned int now, bool early)
+{
+  SDL_Keycode k = ev.key;
+  if(ev.type == kRelease) {
+    if(k < kKeymapSize && !early) {
+      if((int)(now - key_pressed_at_[k]) < 0) key_pressed_at_[k] = now; /* cpu reset */
+      unsigned int held = (ev.at - key_pressed_stamp_[k]);
+      if((int)held < (int)kKeyHold) held = kKeyHold;
+      if((int)(now - (key_pressed_at_[k] + held)) < 0) return false;
+    }
+    handle_keyup(k);
+  } else {
+    if(k < kKeymapSize) {
+      key_pressed_at_[k] = now;
+      key_pressed_stamp_[k] = ev.at;
+    }
+    handle_keydown(k);
+  }
+  return true;
+}
+#endif /* DESKTOP && SDL_ENABLED */
+
 // keyboard handling ///////////////////////////////////////////////////////////
 
 /**
@@ -354,62 +536,61 @@ void IO::process_events()
 #if DESKTOP
 void IO::handle_keydown(SDL_Keycode k)
 {
-  try
-  {
-    /* D("CODE: %2X\n",k); */
-
-    uint8_t mask = ~(1 << keymap_.at(k).second); /* PRB */
-    switch (k) { /* Handle special keypress combo's */
-      uint8_t shiftmask;
-      case SDL_SCANCODE_ESCAPE:
-        runstop = true;
-        break;
-      case SDL_SCANCODE_CAPSLOCK: /* (Un)set shiftlock */
-        shiftlock = !shiftlock;
-        if (shiftlock) {
-          /* shiftlock off */
-          shiftmask = ~(1 << keymap_.at(SDL_SCANCODE_LSHIFT).second);
-          keyboard_matrix_[keymap_.at(SDL_SCANCODE_LSHIFT).first] &= shiftmask;
-        } else {
-          /* shiftlock on */
-          shiftmask = (1 << keymap_.at(SDL_SCANCODE_LSHIFT).second);
-          keyboard_matrix_[keymap_.at(SDL_SCANCODE_LSHIFT).first] |= shiftmask;
-        }
-        break;
-      case SDL_SCANCODE_UP: /* Let up be up */
-      case SDL_SCANCODE_LEFT: /* And left be left */
-          keyboard_matrix_[keymap_.at(SDL_SCANCODE_LSHIFT).first]
-            &= ~(1 << keymap_.at(SDL_SCANCODE_LSHIFT).second);
-        break;
-      case SDL_SCANCODE_PAGEUP:
-        if (runstop == true) {
-          /* RUN/STOP RESTORE PRESSED */
-          if(c64_->sid_->isSIDplaying()) {
-            // enable kernel and basic rom in ram
-            c64_->sid_->set_playing(false);
-            c64_->mem_->write_byte(0x0001, 0x37);
-          }
-          c64_->sid_->reset();
-          c64_->cart_->reset(); /* NOTE: Disables cart contents e.g. MC6850 */
-          c64_->pla_->reset();
-          this->reset(); /* IO */
-          c64_->vic_->reset();
-          c64_->cia1_->reset();
-          c64_->cia2_->reset();
-          c64_->cpu_->reset();
-        }
-        break;
-      default:
-        break;
-    }
-    keyboard_matrix_[keymap_.at(k).first] &= mask; /* PRA */
-
-    c64_->mem_->kCIA1MemWr[0x00] |= (1<<keymap_.at(k).first);  /* PRA ~ ROW */
-    c64_->mem_->kCIA1MemWr[0x01] |= (1<<keymap_.at(k).second); /* PRB ~ COL */
-  }
-  catch(const std::out_of_range){
+  /* D("CODE: %2X\n",k); */
+  if(k >= kKeymapSize || keymap_[k] == kNoKey) {
     printf ("KEY %02X IS OUT OF RANGE\n",k);
+    return;
+  }
+
+  uint8_t mask = ~(1 << key_row(k)); /* PRB */
+  switch (k) { /* Handle special keypress combo's */
+    uint8_t shiftmask;
+    case SDL_SCANCODE_ESCAPE:
+      runstop = true;
+      break;
+    case SDL_SCANCODE_CAPSLOCK: /* (Un)set shiftlock */
+      shiftlock = !shiftlock;
+      if (shiftlock) {
+        /* shiftlock off */
+        shiftmask = ~(1 << key_row(SDL_SCANCODE_LSHIFT));
+        keyboard_matrix_[key_col(SDL_SCANCODE_LSHIFT)] &= shiftmask;
+      } else {
+        /* shiftlock on */
+        shiftmask = (1 << key_row(SDL_SCANCODE_LSHIFT));
+        keyboard_matrix_[key_col(SDL_SCANCODE_LSHIFT)] |= shiftmask;
+      }
+      break;
+    case SDL_SCANCODE_UP: /* Let up be up */
+    case SDL_SCANCODE_LEFT: /* And left be left */
+        keyboard_matrix_[key_col(SDL_SCANCODE_LSHIFT)]
+          &= ~(1 << key_row(SDL_SCANCODE_LSHIFT));
+      break;
+    case SDL_SCANCODE_PAGEUP:
+      if (runstop == true) {
+        /* RUN/STOP RESTORE PRESSED */
+        if(c64_->sid_->isSIDplaying()) {
+          // enable kernel and basic rom in ram
+          c64_->sid_->set_playing(false);
+          c64_->mem_->write_byte(0x0001, 0x37);
+        }
+        c64_->sid_->reset();
+        c64_->cart_->reset(); /* NOTE: Disables cart contents e.g. MC6850 */
+        c64_->pla_->reset();
+        this->reset(); /* IO */
+        c64_->vic_->reset();
+        c64_->cia1_->reset();
+        c64_->cia2_->reset();
+        c64_->cpu_->reset();
+      }
+      break;
+    default:
+      break;
   }
+  keyboard_matrix_[key_col(k)] &= mask; /* PRA */
+  update_keyboard_rows();
+
+  c64_->cia1_->regs().pra |= (1<<key_col(k));  /* PRA ~ ROW */
+  c64_->cia1_->regs().prb |= (1<<key_row(k)); /* PRB ~ COL */
 }
 #endif /* DESKTOP */
 
@@ -419,24 +600,23 @@ void IO::handle_keydown(SDL_Keycode k)
 #if DESKTOP
 void IO::handle_keyup(SDL_Keycode k)
 {
-  try
-  {
-    switch (k) { /* Handle special keypress combo's */
-      case SDL_SCANCODE_ESCAPE: runstop = false; break;
-      case SDL_SCANCODE_UP: /* depress shift on release */
-      case SDL_SCANCODE_LEFT:
-        keyboard_matrix_[keymap_.at(SDL_SCANCODE_LSHIFT).first]
-          |= (1 << keymap_.at(SDL_SCANCODE_LSHIFT).second);
-        break;
-      default: break;
-    }
+  if(k >= kKeymapSize || keymap_[k] == kNoKey) return;
 
-    uint8_t mask = (1 << keymap_.at(k).second);    /* PRB */
-    keyboard_matrix_[keymap_.at(k).first] |= mask; /* PRA */
-    c64_->mem_->kCIA1MemWr[0x01] &= ~(1<<keymap_.at(k).second); /* PRB ~ COL */
-    c64_->mem_->kCIA1MemWr[0x00] &= ~(1<<keymap_.at(k).first);  /* PRA ~ ROW */
+  switch (k) { /* Handle special keypress combo's */
+    case SDL_SCANCODE_ESCAPE: runstop = false; break;
+    case SDL_SCANCODE_UP: /* depress shift on release */
+    case SDL_SCANCODE_LEFT:
+      keyboard_matrix_[key_col(SDL_SCANCODE_LSHIFT)]
+        |= (1 << key_row(SDL_SCANCODE_LSHIFT));
+      break;
+    default: break;
   }
-  catch(const std::out_of_range){}
+
+  uint8_t mask = (1 << key_row(k));    /* PRB */
+  keyboard_matrix_[key_col(k)] |= mask; /* PRA */
+  update_keyboard_rows();
+  c64_->cia1_->regs().prb &= ~(1<<key_row(k)); /* PRB ~ COL */
+  c64_->cia1_->regs().pra &= ~(1<<key_col(k));  /* PRA ~ ROW */
 }
 #endif /* DESKTOP */
 
@@ -449,18 +629,58 @@ void IO::handle_keyup(SDL_Keycode k)
 #if DESKTOP
 void IO::type_character(char c)
 {
-  try
+  int u = toupper((unsigned char)c);
+  if(u >= 128 || charmap_[u] == 0) return;
+  SDL_Keycode k = (charmap_[u] & 0xff);
+  bool shifted = (charmap_[u] & kShifted);
+  /* D("kPress %c %x\n",c,k); */
+  if(shifted) key_event_queue_.push(std::make_pair(kPress,(SDL_Keycode)SDL_SCANCODE_LSHIFT));
+  key_event_queue_.push(std::make_pair(kPress,k));
+  /* D("kRelease %c %x\n",c,k); */
+  if(shifted) key_event_queue_.push(std::make_pair(kRelease,(SDL_Keycode)SDL_SCANCODE_LSHIFT));
+  key_event_queue_.push(std::make_pair(kRelease,k));
+}
+#endif /* DESKTOP */
+
+/**
+ * @brief type a character through the keyboard buffer
+ *
+ * Much faster than type_character(), characters are stored
+ * as PETSCII and moved into the KERNAL keyboard buffer as
+ * soon as BASIC or a program reads it, at most a buffer
+ * full at a time.
+ *
+ * @return false if the character has no unshifted PETSCII
+ * code and was dropped
+ */
+#if DESKTOP
+bool IO::inject_character(char c)
+{
+  uint8_t p = toupper((unsigned char)c);
+  if(p == '\n') p = 0x0d; /* RETURN */
+  else if(p == '\t') p = ' ';
+  else if(p < 0x20 || p > 0x5f) return false; /* not in unshifted PETSCII */
+  inject_queue_.push(p);
+  return true;
+}
+
+/**
+ * @brief top up the KERNAL keyboard buffer
+ * Called with the cpu at GETIN or at the CHRIN wait loop,
+ * right before the count at $c6 is read
+ */
+void IO::inject_refill()
+{
+  uint8_t *ram = c64_->mem_->mem_ram();
+  uint8_t size = ram[kAddrKeyBufferMax];
+  if(size > kKeyBufferSize) size = kKeyBufferSize;
+  uint8_t n = ram[kAddrKeyCount];
+  while(n < size && !inject_queue_.empty())
   {
-    for(SDL_Keycode &k: charmap_.at(toupper(c))) {
-      /* D("kPress %c %x\n",c,k); */
-      key_event_queue_.push(std::make_pair(kPress,k));
-    }
-    for(SDL_Keycode &k: charmap_.at(toupper(c))) {
-      /* D("kRelease %c %x\n",c,k); */
-      key_event_queue_.push(std::make_pair(kRelease,k));
-    }
+    ram[kAddrKeyBuffer + n++] = inject_queue_.front();
+    inject_queue_.pop();
   }
-  catch(const std::out_of_range){}
+  ram[kAddrKeyCount] = n;
 }
 #endif /* DESKTOP */
 
@@ -483,26 +703,138 @@ void IO::screen_draw_border(int y, int color)
  * @brief refresh screen
  * Called from vic->emulate();
  *
- * Upload the texture to the GPU
+ * Hands the finished frame to the presentation thread and
+ * continues on the next free buffer, skipped frames (present
+ * is false) keep the current buffer and only sync
  */
-void IO::screen_refresh()
+void IO::screen_refresh(bool present)
 {
   #if DESKTOP
-  #if SDL_ENABLED
-  if(!nosdl) {
-    SDL_UpdateTexture(texture_, NULL, frame_, cols_ * sizeof(uint32_t));
-    SDL_RenderClear(renderer_);
-    SDL_RenderCopy(renderer_,texture_, NULL, NULL);
-    SDL_RenderPresent(renderer_);
+  if(capture_ != nullptr) {
+    if(present)
+      capture_->push(frame_);
+    else
+      capture_->repeat(); /* keep the capture in emulated time */
+    if(capture_frames != 0 && ++captured_ >= capture_frames)
+      retval_ = false;
   }
-  #endif
+  if(present) {
+    back_frame_ = (ready_frame_.exchange(back_frame_ | kFreshFrame,
+                                         std::memory_order_acq_rel) & kFrameIndex);
+    frame_ = frames_[back_frame_];
+  }
+  #elif EMBEDDED
+  (void)present;
   #endif /* DESKTOP */
+  #if DESKTOP && SDL_ENABLED
+  if(!nosdl) pump_events();
+  #endif
   /* process events once every frame */
   process_events();
   /* perform vertical refresh sync */
   vsync();
 }
 
+// presentation ////////////////////////////////////////////////////////////////
+
+#if DESKTOP && SDL_ENABLED
+/**
+ * @brief presentation thread
+ *
+ * Owns the SDL renderer and texture. Picks up the newest finished
+ * frame, uploads it and presents it, so slow present calls or
+ * compositor stalls never hold up the emulation thread. The window
+ * and its events stay on the main thread.
+ */
+void *IO::present_thread(void)
+{
+  pthread_setname_np(pthread_self(), "Present Thread");
+  bool lock = display_locked_.load();
+  /* use a single texture and hardware acceleration */
+  renderer_ = SDL_CreateRenderer(window_, -1,
+    (SDL_RENDERER_ACCELERATED | (lock ? SDL_RENDERER_PRESENTVSYNC : 0)));
+  texture_  = SDL_CreateTexture(renderer_,
+                                SDL_PIXELFORMAT_ARGB8888,
+                                SDL_TEXTUREACCESS_STREAMING,
+                                cols_,
+                                rows_);
+
+  while(present_running_.load(std::memory_order_acquire))
+  {
+    if(expose_.exchange(false, std::memory_order_relaxed))
+      redraw_ = true;
+    /* newest finished frame, if any */
+    if((ready_frame_.load(std::memory_order_acquire) & kFreshFrame) != 0)
+    {
+      front_frame_ = (ready_frame_.exchange(front_frame_,
+                                            std::memory_order_acq_rel) & kFrameIndex);
+      redraw_ |= lock; /* present blocks until vblank */
+      present_frame();
+    }
+    else if(redraw_ || lock)
+    {
+      redraw_ = true;
+      present_frame();
+    }
+    else
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  SDL_DestroyTexture(texture_);
+  SDL_DestroyRenderer(renderer_);
+  return NULL;
+}
+
+/**
+ * @brief upload changed lines of the front frame and present it
+ *
+ * shadow_ mirrors the texture, only the span of lines that differ
+ * from it is locked and copied into the streaming texture.
+ */
+void IO::present_frame()
+{
+  const uint32_t *f = frames_[front_frame_];
+  const size_t pitch = cols_ * sizeof(uint32_t);
+  int first = -1, last = -1;
+  for(size_t y = 0 ; y < rows_ ; y++)
+  {
+    uint32_t *s = &shadow_[y * cols_];
+    if(memcmp(s, &f[y * cols_], pitch) != 0)
+    {
+      memcpy(s, &f[y * cols_], pitch);
+      if(first < 0) first = y;
+      last = y;
+    }
+  }
+  if(first >= 0)
+  {
+    SDL_Rect r = {0, first, (int)cols_, (last - first + 1)};
+    void *pixels;
+    int tpitch;
+    if(SDL_LockTexture(texture_, &r, &pixels, &tpitch) == 0)
+    {
+      for(int y = first ; y <= last ; y++)
+      {
+        memcpy((uint8_t *)pixels + (y - first) * tpitch,
+               &shadow_[y * cols_], pitch);
+      }
+      SDL_UnlockTexture(texture_);
+    }
+  }
+  else if(!redraw_)
+  {
+    return; /* nothing changed */
+  }
+  redraw_ = false;
+  SDL_RenderClear(renderer_);
+  SDL_RenderCopy(renderer_,texture_, NULL, NULL);
+  SDL_RenderPresent(renderer_);
+  vblanks_.fetch_add(1, std::memory_order_release);
+}
+#endif /* DESKTOP && SDL_ENABLED */
+
 /**
  * @brief vsync
  *
@@ -524,13 +856,61 @@ void IO::vsync()
   using namespace std::chrono;
   auto t = high_resolution_clock::now() - prev_frame_was_at_;
   duration<double> rr(Vic::kRefreshRate);
+  /* host time spent on this frame as a fraction of the frame time */
+  frame_load_ = (duration_cast<duration<double>>(t).count() / rr.count());
+  #if DESKTOP
+  if(!pacing)
+  { /* offline rendering */
+    prev_frame_was_at_ = high_resolution_clock::now();
+    return;
+  }
   /**
-   * Microsoft's chrono is buggy and does not properly handle
-   * doubles, we need to recast to milliseconds.
+   * The deadline for the end of this frame follows from the number of
+   * cycles emulated since the pacing epoch, so rounding never adds up
+   * and frames of odd length (e.g. after a reset) get their real time.
    */
-  #if DESKTOP
-  auto ttw = duration_cast<milliseconds>(rr - t);
-  std::this_thread::sleep_for(ttw);
+  steady_clock::time_point now = steady_clock::now();
+  unsigned int c = c64_->cpu_->cycles();
+  unsigned int dc = (c - pace_prev_cycles_);
+  pace_prev_cycles_ = c;
+  if(pace_resync_ || dc > (unsigned int)(Vic::kRefrehRate * 4))
+  { /* first frame or cpu reset, restart the epoch */
+    pace_resync_ = false;
+    pace_epoch_ = now;
+    pace_cycles_ = 0;
+  }
+  else
+  {
+    pace_cycles_ += dc;
+    /* keep the epoch close so the nanosecond math can't overflow */
+    while(pace_cycles_ >= Vic::kClockFrequency)
+    {
+      pace_cycles_ -= Vic::kClockFrequency;
+      pace_epoch_ += seconds(1);
+    }
+  }
+  steady_clock::time_point deadline = pace_epoch_ +
+    nanoseconds((pace_cycles_ * 1000000000ULL) / Vic::kClockFrequency);
+
+  #if SDL_ENABLED
+  if(display_locked_.load(std::memory_order_relaxed))
+  {
+    /* the display refresh paces us, the deadline is only a fallback */
+    wait_for_vblank(deadline + milliseconds(kMaxBehindMs));
+    pace_resync_ = true;
+  }
+  else
+  #endif
+  if((now - deadline) > milliseconds(kMaxBehindMs))
+  { /* too far behind to catch up, don't run a burst of frames */
+    pace_resync_ = true;
+    stat_late_++;
+  }
+  else
+  {
+    sleep_until(deadline);
+  }
+  frame_stats(deadline);
   #elif EMBEDDED
   /* TODO: Cast to nanoseconds and then calculation actual cpu cycles */
   /* Cast duration to microseconds */
@@ -546,3 +926,92 @@ void IO::vsync()
   #endif /* EMBEDDED */
   prev_frame_was_at_ = std::chrono::high_resolution_clock::now();
 }
+
+#if DESKTOP
+/**
+ * @brief sleep until an absolute deadline
+ *
+ * Sleeps on the monotonic clock to just before the deadline
+ * and spins the last stretch, so wakeup jitter of the kernel
+ * timer does not end up in the frame time.
+ */
+void IO::sleep_until(std::chrono::steady_clock::time_point deadline)
+{
+  using namespace std::chrono;
+  steady_clock::time_point coarse = deadline - microseconds(kSpinMicros);
+  if(coarse > steady_clock::now())
+  {
+    #if defined(__linux__)
+    /* steady_clock is CLOCK_MONOTONIC on Linux */
+    int64_t ns = duration_cast<nanoseconds>(coarse.time_since_epoch()).count();
+    struct timespec ts;
+    ts.tv_sec  = (time_t)(ns / 1000000000);
+    ts.tv_nsec = (long)(ns % 1000000000);
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+    #else
+    std::this_thread::sleep_until(coarse);
+    #endif
+  }
+  while(steady_clock::now() < deadline) {}
+}
+
+/**
+ * @brief collect and periodically print frame time statistics
+ *
+ * Frame time is measured between consecutive vsync wakeups,
+ * lateness against the frame deadline.
+ */
+void IO::frame_stats(std::chrono::steady_clock::time_point deadline)
+{
+  using namespace std::chrono;
+  steady_clock::time_point now = steady_clock::now();
+  double ft = duration_cast<duration<double,std::milli>>(now - stat_prev_frame_).count();
+  double late = duration_cast<duration<double,std::milli>>(now - deadline).count();
+  stat_prev_frame_ = now;
+  if(stat_frames_ == 0)
+  {
+    stat_min_ = stat_max_ = ft;
+    stat_sum_ = stat_sqsum_ = stat_late_max_ = 0.0;
+  }
+  stat_frames_++;
+  stat_sum_ += ft;
+  stat_sqsum_ += (ft * ft);
+  if(ft < stat_min_) stat_min_ = ft;
+  if(ft > stat_max_) stat_max_ = ft;
+  if(late > stat_late_max_) stat_late_max_ = late;
+  if(stat_frames_ >= kStatFrames)
+  {
+    double avg = (stat_sum_ / stat_frames_);
+    double var = (stat_sqsum_ / stat_frames_) - (avg * avg);
+    if(log_frametimes)
+    {
+      printf("[FRAME] %u frames avg %.3fms min %.3fms max %.3fms jitter %.3fms latest wakeup %.3fms resyncs %u%s\n",
+        stat_frames_, avg, stat_min_, stat_max_, (var > 0 ? sqrt(var) : 0.0),
+        stat_late_max_, stat_late_,
+        #if SDL_ENABLED
+        (display_locked_.load() ? " (display locked)" : "")
+        #else
+        ""
+        #endif
+      );
+    }
+    stat_frames_ = 0;
+    stat_late_ = 0;
+  }
+}
+#endif /* DESKTOP */
+
+#if DESKTOP && SDL_ENABLED
+/**
+ * @brief wait for the presentation thread to pass a vblank
+ */
+void IO::wait_for_vblank(std::chrono::steady_clock::time_point timeout)
+{
+  while(vblanks_.load(std::memory_order_acquire) == last_vblank_ &&
+        std::chrono::steady_clock::now() < timeout)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  last_vblank_ = vblanks_.load(std::memory_order_acquire);
+}
+#endif /* DESKTOP && SDL_ENABLED */
@@ -22,13 +22,15 @@
 #define EMUDORE_IO_H
 
 #include <queue>
+#include <atomic>
 #include <chrono>
 #include <thread>
-#include <vector>
+#include <string>
 #include <utility>
-#include <unordered_map>
 
 #if DESKTOP
+#include <pthread.h>
+#include <ringbuffer.h>
 #if SDL_ENABLED
 #include <SDL.h>
 #else
@@ -57,7 +59,20 @@ class IO
     SDL_Texture *texture_;
     SDL_PixelFormat *format_;
     #endif /* SDL_ENABLED */
+    /**
+     * triple buffered frames, the renderer draws into frame_ (back)
+     * while the presentation thread shows front, finished frames are
+     * swapped through ready_frame_ without ever blocking emulation
+     */
     uint32_t *frame_;
+    uint32_t *frames_[3];
+    int back_frame_;
+    std::atomic<int> ready_frame_;
+    static const int kFreshFrame = 0x4;
+    static const int kFrameIndex = 0x3;
+    /* video capture */
+    VideoCapture *capture_;
+    unsigned int captured_;
     #endif /* DESKTOP */
     size_t cols_;
     size_t rows_;
@@ -65,11 +80,22 @@ class IO
     unsigned int color_palette[16];
     #endif
     uint8_t keyboard_matrix_[8];
+    /* rows seen for every column select (PRA) value, rebuilt on key change */
+    uint8_t keyboard_rows_[256];
+    void update_keyboard_rows();
     bool retval_ = true;
-    /* keyboard mappings */
+    /* keyboard mappings, dense tables indexed by scancode and character */
     #if DESKTOP
-    std::unordered_map<SDL_Keycode,std::pair<int,int>> keymap_;
-    std::unordered_map<char,std::vector<SDL_Keycode>> charmap_;
+    static constexpr unsigned int kKeymapSize = 256;
+    static constexpr uint8_t kNoKey = 0xff;
+    static constexpr uint16_t kShifted = 0x100;
+    uint8_t keymap_[kKeymapSize]; /* (col << 3) | row or kNoKey */
+    uint16_t charmap_[128];       /* scancode | kShifted, 0 if unmapped */
+    void map_key(SDL_Keycode k, int col, int row){keymap_[k] = ((col << 3) | row);};
+    void map_char(char c, SDL_Keycode k, bool shifted = false)
+      {charmap_[(int)c] = (k | (shifted ? kShifted : 0));};
+    int key_col(SDL_Keycode k){return (keymap_[k] >> 3);};
+    int key_row(SDL_Keycode k){return (keymap_[k] & 0x7);};
     #endif
     enum kKeyEvent
     {
@@ -81,10 +107,69 @@ class IO
     std::queue<std::pair<kKeyEvent,SDL_Keycode>> key_event_queue_;
     unsigned int next_key_event_at_;
     static const int kWait = 18000;
+    /* typed text, fed straight into the KERNAL keyboard buffer */
+    std::queue<uint8_t> inject_queue_;
+    void inject_refill();
+    static constexpr uint16_t kAddrKeyBuffer    = 0x0277; /* KEYD */
+    static constexpr uint16_t kAddrKeyCount     = 0x00c6; /* NDX */
+    static constexpr uint16_t kAddrKeyBufferMax = 0x0289; /* XMAX */
+    static constexpr uint8_t  kKeyBufferSize    = 10;
+    static constexpr uint16_t kAddrKernalGetin  = 0xf13e; /* GETIN keyboard */
+    static constexpr uint16_t kAddrKernalInput  = 0xe5cd; /* CHRIN waiting for a key */
+    #endif
+    /* presentation thread */
+    #if DESKTOP && SDL_ENABLED
+    pthread_t present_threadid_;
+    std::atomic<bool> present_running_;
+    std::atomic<bool> expose_; /* window needs a redraw */
+    int front_frame_;
+    uint32_t *shadow_; /* texture contents, used for dirty line tracking */
+    bool redraw_;
+    /* host key events, stamped with the emulated cycle they were seen at */
+    struct KeyEvent
+    {
+      kKeyEvent type;
+      SDL_Keycode key;
+      unsigned int at;
+    };
+    RingBuffer<KeyEvent,256> sdl_key_events_;
+    unsigned long key_events_dropped_;
+    void pump_events();
+    void queue_key_event(kKeyEvent type, SDL_Keycode k);
+    bool apply_key_event(const KeyEvent &ev, unsigned int now, bool early = false);
+    /* per scancode, alongside keymap_ */
+    unsigned int key_pressed_at_[kKeymapSize];    /* cycle the press was applied */
+    unsigned int key_pressed_stamp_[kKeymapSize]; /* and its stamp */
+    static constexpr unsigned int kKeyHold = 19656; /* one frame, covers a keyboard scan */
+    void *present_thread(void);
+    void present_frame(void);
+    /* display refresh lock */
+    std::atomic<bool> display_locked_;
+    std::atomic<unsigned int> vblanks_;
+    unsigned int last_vblank_;
+    void wait_for_vblank(std::chrono::steady_clock::time_point timeout);
     #endif
     /* vertical refresh sync */
     std::chrono::high_resolution_clock::time_point prev_frame_was_at_;
+    double frame_load_;
     void vsync();
+    #if DESKTOP
+    /* absolute deadline frame pacing */
+    std::chrono::steady_clock::time_point pace_epoch_;
+    uint64_t pace_cycles_; /* emulated cycles since pace_epoch_ */
+    unsigned int pace_prev_cycles_;
+    bool pace_resync_;
+    static constexpr int kSpinMicros = 300;
+    static constexpr int kMaxBehindMs = 100;
+    void sleep_until(std::chrono::steady_clock::time_point deadline);
+    /* frame time statistics */
+    std::chrono::steady_clock::time_point stat_prev_frame_;
+    double stat_min_, stat_max_, stat_sum_, stat_sqsum_, stat_late_max_;
+    unsigned int stat_frames_;
+    unsigned int stat_late_;
+    void frame_stats(std::chrono::steady_clock::time_point deadline);
+    static constexpr unsigned int kStatFrames = 250; /* ~5 seconds */
+    #endif
 
     /* Key combination vars */
     static bool runstop;
@@ -95,7 +180,18 @@ class IO
   public:
     IO(C64 *c64, bool sdl);
     ~IO();
+    #if DESKTOP && SDL_ENABLED
+    static void *_Present_Thread(void *context)
+    { /* Required for supplying private function to pthread_create */
+      return ((IO *)context)->present_thread();
+    }
+    #endif
     bool nosdl;
+    static std::string capture_file;
+    static unsigned int capture_frames;
+    static bool log_frametimes;
+    static bool display_lock;
+    static bool pacing; /* false renders as fast as possible */
     void reset(void);
     bool emulate();
     void process_events();
@@ -106,12 +202,18 @@ class IO
     void handle_keydown(SDL_Keycode k);
     void handle_keyup(SDL_Keycode k);
     void type_character(char c);
+    bool inject_character(char c);
     #endif
-    inline uint8_t keyboard_matrix_row(int col){return keyboard_matrix_[col];};
+    inline uint8_t keyboard_rows(uint8_t cols){return keyboard_rows_[cols];};
     void screen_update_pixel(int x, int y, int color);
     void screen_draw_rect(int x, int y, int n, int color);
     void screen_draw_border(int y, int color);
-    void screen_refresh();
+    void screen_refresh(bool present = true);
+    double frame_load(){return frame_load_;};
+    #if DESKTOP
+    const uint32_t *frame(){return frame_;};
+    size_t frame_size(){return (cols_ * rows_);};
+    #endif
 
     /* Needs moving to independent class */
     void set_disk_loaded(bool ready){diskpresent = ready;};
@@ -16,12 +16,14 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <bitset>
 #include <iomanip>
 #include <string.h>
 
 #include <loader.h>
 #include <sidfile.h>
+#include <basic.h>
 
 #include "reloc65.h"
 
@@ -75,12 +77,71 @@ uint16_t Loader::read_short_le()
   char b;
   uint16_t v = 0;
   is_.get(b);
-  v |= (b);
+  v |= (uint8_t)b;
   is_.get(b);
-  v |= b << 8;
+  v |= (uint8_t)b << 8;
   return v;
 }
 
+/**
+ * @brief read the rest of the open file in one go
+ */
+std::vector<uint8_t> Loader::read_rest()
+{
+  std::vector<uint8_t> data;
+  std::streampos pos = is_.tellg();
+  is_.seekg(0, std::ios::end);
+  std::streampos end = is_.tellg();
+  if (pos < 0 || end < pos) return data;
+  is_.seekg(pos);
+  data.resize(end - pos);
+  is_.read((char *)data.data(), data.size());
+  data.resize(is_.gcount());
+  return data;
+}
+
+/**
+ * @brief copy a program image into memory
+ *
+ * Plain RAM is copied in bulk, only the parts that overlap
+ * the processor port ($00-$01) or the IO area ($d000-$dfff)
+ * go through write_byte() so devices and banking see them.
+ *
+ * @return number of bytes stored, the image is clipped at $ffff
+ */
+size_t Loader::copy_to_ram(uint16_t addr, const std::vector<uint8_t> &data)
+{
+  size_t len = data.size();
+  if (len > (size_t)(0x10000 - addr)) {
+    fprintf(stderr, "[LOADER] Image at $%04X is %zu bytes, clipped at $FFFF\n", addr, len);
+    len = (0x10000 - addr);
+  }
+  uint8_t *ram = c64_->mem_->mem_ram();
+  uint32_t end = (addr + len);
+  /* split into ranges that are plain RAM and ranges that are not */
+  static const uint32_t kDecoded[][2] = {
+    {0x0000, 0x0002}, /* processor port */
+    {0xd000, 0xe000}, /* IO */
+  };
+  uint32_t a = addr;
+  for (auto &range : kDecoded)
+  {
+    if (a >= end) break;
+    if (range[1] <= a) continue;
+    uint32_t bulk_end = std::min(end, range[0]);
+    if (bulk_end > a) {
+      memcpy(&ram[a], &data[a - addr], bulk_end - a);
+      a = bulk_end;
+    }
+    for (; a < std::min(end, range[1]) ; a++)
+    {
+      c64_->mem_->write_byte(a, data[a - addr]);
+    }
+  }
+  if (a < end) memcpy(&ram[a], &data[a - addr], end - a);
+  return len;
+}
+
 // BASIC listings ///////////////////////////////////////////////////////////
 
 void Loader::bas(const std::string &f)
@@ -89,17 +150,57 @@ void Loader::bas(const std::string &f)
   is_.open(f,std::ios::in);
 }
 
+/**
+ * @brief tokenize a BASIC listing straight into memory
+ *
+ * Numbered lines are tokenized and stored at $0801, other lines
+ * (RUN, POKE etc.) are typed in direct mode once the program is
+ * in place, a NEW only drops the lines read so far.
+ */
 void Loader::load_basic()
 {
-  char c;
-  if(is_.is_open())
+  if(!is_.is_open()) return;
+  BasicTokenizer basic(kBasicPrgStart);
+  std::vector<std::string> direct;
+  std::string line;
+  while(std::getline(is_, line))
   {
-    while(is_.good())
-    {
-      is_.get(c);
-      c64_->io_->IO::type_character(c);
+    if(!line.empty() && line.back() == '\r') line.pop_back();
+    if(basic.add_line(line)) continue;
+    size_t i = line.find_first_not_of(' ');
+    if(i == std::string::npos) continue;
+    std::string cmd = line.substr(i, 3);
+    for(char &c: cmd) c = toupper((unsigned char)c);
+    if(cmd == "REM") continue; /* nothing to execute */
+    if(cmd == "NEW") {
+      basic.clear();
+      continue;
     }
+    direct.push_back(line);
   }
+  if(basic.dropped() != 0)
+    fprintf(stderr, "[LOADER] %zu characters without a PETSCII code dropped from the listing\n", basic.dropped());
+  if(!basic.empty()) {
+    std::vector<uint8_t> prg = basic.program();
+    uint16_t end = (kBasicPrgStart + prg.size());
+    if(prg.size() > (size_t)(kBasicEnd - kBasicPrgStart)) {
+      fprintf(stderr, "[LOADER] BASIC program does not fit in memory (%zu bytes)\n", prg.size());
+      return;
+    }
+    memcpy(&c64_->mem_->mem_ram()[kBasicPrgStart], prg.data(), prg.size());
+    /* make BASIC happy */
+    c64_->mem_->write_word(kBasicTxtTab,kBasicPrgStart);
+    c64_->mem_->write_word(kBasicVarTab,end);
+    c64_->mem_->write_word(kBasicAryTab,end);
+    c64_->mem_->write_word(kBasicStrEnd,end);
+  }
+  size_t dropped = 0;
+  for(std::string &l: direct) {
+    for(char &c: l) if(!c64_->io_->IO::inject_character(c)) dropped++;
+    c64_->io_->IO::inject_character('\n');
+  }
+  if(dropped != 0)
+    fprintf(stderr, "[LOADER] %zu characters without a PETSCII code dropped from direct mode lines\n", dropped);
 }
 
 // BIN //////////////////////////////////////////////////////////////////////
@@ -112,7 +213,6 @@ void Loader::bin(const std::string &f)
 
 void Loader::load_bin()
 {
-  char b;
   uint16_t bbuf, addr;
   bbuf = addr = 0x8000; /* Fix binary address at $400 */
   if (init_addr != 0) {addr = init_addr;};
@@ -127,16 +227,7 @@ void Loader::load_bin()
   }
 
   if(!iscart && is_.is_open()) {
-    while(is_.good()) /* BUG: THIS WORKS */
-    {
-      is_.get(b);
-      c64_->mem_->write_byte(bbuf++,b);
-    }
-    /* BUG: This does not!? */
-    // is_.seekg (0, is_.end);
-    // std::streamoff length = is_.tellg();
-    // is_.seekg (0, is_.beg);
-    // is_.read ((char *) &mem_->mem_ram()[addr],length);
+    copy_to_ram(bbuf, read_rest());
     c64_->cpu_->pc(addr);
   }
 }
@@ -151,16 +242,11 @@ void Loader::prg(const std::string &f)
 
 void Loader::load_prg()
 {
-  char b;
   uint16_t pbuf;
-  pbuf = load_addr = read_short_le();
   if(is_.is_open())
   {
-    while(is_.good())
-    {
-      is_.get(b);
-      c64_->mem_->write_byte(pbuf++,b);
-    }
+    load_addr = read_short_le();
+    pbuf = (load_addr + copy_to_ram(load_addr, read_rest()));
 
     /* basic-tokenized prg */
     if(load_addr == kBasicPrgStart)
@@ -174,7 +260,7 @@ void Loader::load_prg()
         if (basic_run) {
           /* type and exec RUN */
           for(char &c: std::string("RUN\n")) {
-            c64_->io_->IO::type_character(c);
+            c64_->io_->IO::inject_character(c);
           }
         } else if (init_addr == 0x0) { /* BUG: Not always correct */
           init_addr = ((c64_->mem_->read_byte(load_addr)|c64_->mem_->read_byte(load_addr+0x1)<<8)+0x2);
@@ -466,6 +552,20 @@ void Loader::load_sid()
   // }
 
   c64_->sid_->sid_flush();
+  /* extra chips are given as the middle byte of $Dxx0 */
+  uint16_t sid_addr[Memory::kMaxSIDs] = {0xd400, 0, 0, 0};
+  int sids = 1;
+  for (int n = 1; n < Memory::kMaxSIDs; n++) {
+    uint16_t a = sidfile_->GetSIDaddr(n + 1);
+    if (a == 0) break;
+    sid_addr[sids++] = (0xd000 | (a << 4));
+  }
+  c64_->mem_->sid_layout(sid_addr, sids);
+  #if DESKTOP
+  for (int n = 0; n < sids; n++) {
+    c64_->sid_->chip_info(n, sidfile_->GetChipType(std::min(n + 1, 3)), sid_addr[n]);
+  }
+  #endif
   c64_->sid_->set_playing(true);
   // if (!pl_isrsid) c64_->cpu_->pc(c64_->mem_->read_word(Memory::kAddrResetVector));
   // if (!pl_isrsid) c64_->cpu_->irq();
@@ -22,6 +22,7 @@
 #define EMUDORE_LOADER_H
 
 #include <fstream>
+#include <vector>
 #include "c64.h"
 
 
@@ -87,6 +88,8 @@ class Loader
     void load_Psidplayer(uint16_t play, uint16_t init, uint16_t load, uint16_t length, int songno);
     void print_sid_info(); /* TODO: Print on C64 screen */
     uint16_t read_short_le();
+    std::vector<uint8_t> read_rest();
+    size_t copy_to_ram(uint16_t addr, const std::vector<uint8_t> &data);
     void find_free_page();
 
     const unsigned int NUM_SCREEN_PAGES = 4;
@@ -155,6 +158,7 @@ class Loader
     static const uint16_t kBasicVarTab   = 0x002d;
     static const uint16_t kBasicAryTab   = 0x002f;
     static const uint16_t kBasicStrEnd   = 0x0031;
+    static const uint16_t kBasicEnd      = 0xa000; /* MEMSIZ */
 };
 
 
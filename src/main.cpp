@@ -24,6 +24,10 @@
 
 #include <c64.h>
 #include <loader.h>
+#include <sidsynth.h>
+#include <usbsidmock.h>
+#include <snapshot.h>
+#include <statehash.h>
 #include <cstring>
 
 
@@ -90,6 +94,50 @@ void checkargs(int argc, char **argv)
       if(!strcmp(argv[a], "-bin")) {isbinary = true;}
       if(!strcmp(argv[a], "-midi")) {acia = true;} /* BUG: Segmentation fault when used with loading a .bin file */
 
+      if(!strcmp(argv[a], "-sidqueue") && (a+1) < argc) {
+        Sid::high_water = strtoul(argv[a+1], NULL, 10);
+      }
+
+      if(!strcmp(argv[a], "-sidsync") && (a+1) < argc) {
+        Sid::sync_micros = std::max(1,(int)strtol(argv[a+1], NULL, 10));
+      }
+      if(!strcmp(argv[a], "-sidbackend") && (a+1) < argc) {
+        Sid::backend = argv[a+1];
+      }
+      if(!strcmp(argv[a], "-mocklatency") && (a+1) < argc) {
+        UsbsidMock::latency_us = strtoul(argv[a+1], NULL, 10);
+      }
+      if(!strcmp(argv[a], "-mockjitter") && (a+1) < argc) {
+        UsbsidMock::jitter_us = strtoul(argv[a+1], NULL, 10);
+      }
+      if(!strcmp(argv[a], "-sidcoalesce")) {Sid::coalesce = true;}
+      if(!strcmp(argv[a], "-sidreadback")) {Sid::hw_readback = true;}
+      if(!strcmp(argv[a], "-sidrecord") && (a+1) < argc) {
+        Sid::record_file = argv[++a];
+        continue; /* don't mistake the stream file for a program */
+      }
+      if(!strcmp(argv[a], "-sidserver") && (a+1) < argc) {
+        Sid::server_socket = argv[++a];
+        continue; /* don't mistake the socket for a program */
+      }
+      if(!strcmp(argv[a], "-wav") && (a+1) < argc) {
+        SidSynth::wav_file = argv[++a];
+        continue; /* don't mistake the wav file for a program */
+      }
+      if(!strcmp(argv[a], "-wavlen") && (a+1) < argc) {
+        SidSynth::seconds = strtoul(argv[a+1], NULL, 10);
+      }
+      if(!strcmp(argv[a], "-synth")) {
+        #if SDL_ENABLED
+        SidSynth::play_audio = true;
+        #else
+        fprintf(stderr, "-synth needs SDL audio, use -wav\n");
+        #endif
+      }
+      if(!strcmp(argv[a], "-sidmodel") && (a+1) < argc) {
+        SidSynth::force_model = (!strcmp(argv[a+1], "8580") ? 2 : 1);
+      }
+
       if(!strcmp(argv[a], "-s")) {
         loader->subtune = (strtol(argv[a+1], NULL, 10) - 1);
         printf("SUBTUNE: %d\n",loader->subtune);
@@ -117,6 +165,37 @@ void checkargs(int argc, char **argv)
       if(!strcmp(argv[a], "-logplarw")) {loader->plarwlog = true;}
       if(!strcmp(argv[a], "-logcartrw")) {loader->cartrwlog = true;}
       if(!strcmp(argv[a], "-logtimings")) {C64::log_timings = true;}
+      if(!strcmp(argv[a], "-logframes")) {IO::log_frametimes = true;}
+      if(!strcmp(argv[a], "-logsid")) {SidBackend::log_stats = true;}
+      if(!strcmp(argv[a], "-vsynclock")) {IO::display_lock = true;}
+      if(!strcmp(argv[a], "-capture") && (a+1) < argc) {
+        IO::capture_file = argv[++a];
+        continue; /* don't mistake the capture file for a program */
+      }
+      if(!strcmp(argv[a], "-hashlog") && (a+1) < argc) {
+        StateHash::log_file = argv[++a];
+        continue; /* don't mistake the log file for a program */
+      }
+      if(!strcmp(argv[a], "-nosnapshot")) {Snapshot::enabled = false;}
+      if(!strcmp(argv[a], "-roms") && (a+1) < argc) {
+        Memory::rom_path = argv[++a];
+        continue; /* don't mistake the rom folder for a program */
+      }
+      if(!strcmp(argv[a], "-hashcmp") && (a+2) < argc) {
+        exit(StateHash::compare(argv[a+1], argv[a+2]));
+      }
+      if(!strcmp(argv[a], "-captureframes") && (a+1) < argc) {
+        IO::capture_frames = strtoul(argv[a+1], NULL, 10);
+      }
+
+      if(!strcmp(argv[a], "-frameskip") && (a+1) < argc) {
+        if(!strcmp(argv[a+1], "auto")) {
+          Vic::frame_skip = Vic::kAutoFrameSkip;
+        } else {
+          Vic::frame_skip = std::max(1,(int)strtol(argv[a+1], NULL, 10));
+        }
+        printf("FRAMESKIP: %s\n",argv[a+1]);
+      }
 
       /* Check for file */
       if((strchr(argv[a], '.') != NULL)) {loader->filename = argv[a];}
@@ -130,6 +209,20 @@ void checkargs(int argc, char **argv)
         printf("-crt           : use if cart file is .bin (binary)\n");
         printf("-bin           : unused\n");
         printf("-midi          : hack for emulating mc68b60 acia on cart\n");
+        printf("-frameskip #   : only render every #th frame, or auto\n");
+        printf("                 emulation stays at full speed (default: 1)\n");
+        printf("-vsynclock     : pace frames by a 50Hz display refresh\n");
+        printf("-capture file  : record video to file or fifo, .y4m for\n");
+        printf("                 YUV4MPEG2 otherwise indexed raw (delta/RLE)\n");
+        printf("-captureframes #: stop after capturing # frames\n");
+        printf("-hashlog file  : log per frame state hashes to file\n");
+        printf("-hashcmp a b   : compare two hash logs and report the\n");
+        printf("                 first diverging frame and component\n");
+        printf("-nosnapshot    : cold boot instead of restoring the\n");
+        printf("                 boot snapshot, kept in the -roms dir or\n");
+        printf("                 in assets/roms next to the executable\n");
+        printf("-roms dir      : load ROM images from dir instead of\n");
+        printf("                 the built-in ones\n");
 
         printf("\n");
         printf("-run           : start PRG's from basic with RUN (default: false)\n");
@@ -137,6 +230,33 @@ void checkargs(int argc, char **argv)
         printf("-normal        : run normal emulation for PSID tune play\n");
         printf("                 othwerwise only emulates CPU and CIA1\n");
         printf("-s #           : set SID subtune to play\n");
+        printf("-sidqueue #    : SID writes queued before emulation\n");
+        printf("                 waits for the hardware (default: %zu)\n", Sid::kDefaultHighWater);
+        printf("-sidsync #     : sync SID timing with the wall clock every\n");
+        printf("                 # microseconds without hardware (default: %u)\n", Sid::kDefaultSyncMicros);
+        printf("-sidbackend x  : SID device, one of %s\n", SidBackend::kNames);
+        #if USBSID_DRIVER
+        printf("                 (default: usbsid when found, else null)\n");
+        #else
+        printf("                 (default: null)\n");
+        #endif
+        printf("-mocklatency # : usbsidmock USB latency in microseconds\n");
+        printf("                 (default: %u)\n", UsbsidMock::latency_us);
+        printf("-mockjitter #  : usbsidmock random extra latency up to #\n");
+        printf("                 microseconds (default: %u)\n", UsbsidMock::jitter_us);
+        printf("-sidcoalesce   : drop SID writes that don't change a register\n");
+        printf("                 (voice control writes always pass)\n");
+        printf("-sidreadback   : read all SID registers from the device\n");
+        printf("                 (default: only the paddles)\n");
+        printf("-sidrecord file: record SID writes to file for replay\n");
+        printf("                 with adorable-sidreplay\n");
+        printf("-sidserver path: publish SID writes per frame on a Unix\n");
+        printf("                 socket at path, see sidserver.h\n");
+        printf("-synth         : play SID writes with the built-in synth\n");
+        printf("-wav file      : render the built-in synth to a WAV file\n");
+        printf("-wavlen #      : stop after # seconds of synth output\n");
+        printf("-sidmodel #    : synth chip model 6581 or 8580\n");
+        printf("                 (default: from the tune, else 6581)\n");
 
         printf("\n");
         printf("-init ####     : force init address for PRG/BIN in hex\n");
@@ -145,6 +265,8 @@ void checkargs(int argc, char **argv)
 
         printf("\n");
         printf("-logtimings    : log timings between emulation cycles\n");
+        printf("-logframes     : log frame time statistics every ~5 seconds\n");
+        printf("-logsid        : log SID write pipeline statistics on exit\n");
         printf("-logcpu        : log cpu instructions from boot\n");
         printf("-loginstr      : log cpu instructions after loader\n");
         printf("-logbanksw     : log runtime bank switches\n");
@@ -173,6 +295,11 @@ int main(int argc, char **argv)
     }
   }
 
+  /* nothing plays in real time, render the synth offline */
+  if (nosdl && !SidSynth::wav_file.empty() && !SidSynth::play_audio) {
+    IO::pacing = false;
+  }
+
   /* Init Machine start */
   if (file_loaded) {
     c64 = new C64(nosdl,isbinary,havecart,bankswlog,acia,std::string {""});
@@ -202,6 +329,8 @@ int main(int argc, char **argv)
 
   /* Continue machine startup */
   if (!sidfile) {
+    Snapshot::locate(argv[0]);
+    c64->boot_snapshot();
     c64->start();
   } else {
     bool em_cpu, em_cia1, em_cia2, em_vic, em_io, em_cart;
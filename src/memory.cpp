@@ -22,39 +22,45 @@
 #include <iomanip>
 
 #include <c64.h> /* All classes are loaded through c64.h */
+#include <snapshot.h>
+
+#if DESKTOP
+#include <roms.h> /* generated at build time */
+#endif
 
 #if EMBEDDED
 extern uint8_t c64memory[0x10000];
 #endif
 
+#if DESKTOP
+std::string Memory::rom_path = "";
+#endif
+
 Memory::Memory(C64 * c64) :
   c64_(c64)
 {
   /**
-   * 64 kB memory buffers, zeroed.
+   * 64 kB RAM buffer, zeroed.
    *
-   * We use two buffers to handle special circumstances, for instance,
-   * any write to a ROM-mapped location will in turn store data on the
-   * hidden RAM, this trickery is used in certain graphic modes.
+   * ROM is mapped over it by pointer, any write to a ROM-mapped
+   * location will in turn store data on the hidden RAM, this
+   * trickery is used in certain graphic modes.
    */
   #if EMBEDDED
   mem_ram_ = c64memory;
+  basic_rom_   = c64_->basic_;
+  chargen_rom_ = c64_->chargen_;
+  kernal_rom_  = c64_->kernal_;
   #else
   mem_ram_ = new uint8_t[kMemSize]();
-  mem_rom_ = new uint8_t[kMemSize]();
+  basic_rom_   = kBasicRom;
+  chargen_rom_ = kChargenRom;
+  kernal_rom_  = kKernalRom;
+  rom_override_ = nullptr;
+  if (!rom_path.empty()) load_roms();
   #endif
 
-  /**
-   * 1 KB _Read only_ page buffers, zeroed.
-   */
-  mem_rom_cia1_ = new uint8_t[kPageSize]();
-  mem_rom_cia2_ = new uint8_t[kPageSize]();
-
-  /* configure pointers */
-  kCIA1MemWr = &mem_ram_[kAddrCIA1Page];
-  kCIA1MemRd = &mem_rom_cia1_[0];
-  kCIA2MemWr = &mem_ram_[kAddrCIA2Page];
-  kCIA2MemRd = &mem_rom_cia2_[0];
+  sid_layout(nullptr, 0); /* default SID layout */
 
   D("[EMU] Memory initialized.\n");
 }
@@ -65,13 +71,41 @@ Memory::~Memory()
   mem_ram_ = NULL;
   #else
   delete [] mem_ram_;
-  delete [] mem_rom_;
+  if (rom_override_ != nullptr) delete [] rom_override_;
   #endif
-  delete [] mem_rom_cia1_;
-  delete [] mem_rom_cia2_;
 }
 
 
+/**
+ * @brief builds the SID slot table
+ *
+ * The default layout has four chips repeating over $d400 ~ $d4ff
+ * and the second chip at $d500, on top of that the extra chips of
+ * a tune take their slot at any address the PSID header allows
+ * ($d420 ~ $d7e0 and $de00 ~ $dfe0). Everything else is I/O.
+ */
+void Memory::sid_layout(const uint16_t *addr, int sids)
+{
+  for (int s = 0; s < kSIDSlots; s++) {
+    uint16_t page = ((kAddrSIDFirstPage + (s << 5)) & HiAddrMask);
+    if (page == kAddrSIDFirstPage) {
+      sid_slot_[s] = (s & (kMaxSIDs - 1));
+    } else if (page == kAddrSIDSecondPage) {
+      sid_slot_[s] = 1;
+    } else {
+      sid_slot_[s] = kSIDNone;
+    }
+  }
+  for (int n = 1; n < sids && n < kMaxSIDs; n++) {
+    if ((addr[n] > kAddrSIDFirstPage && addr[n] < kAddrColorFirstPage)
+     || (addr[n] >= kAddrIO1Page && addr[n] <= (kAddrIO2Page | 0xe0))) {
+      sid_slot_[((addr[n] - kAddrSIDFirstPage) >> 5)] = n;
+    } else {
+      D("[EMU] SID %d at $%04X can't be mapped\n", (n + 1), addr[n]);
+    }
+  }
+}
+
 /**
  * @brief writes a byte to RAM without performing I/O
  */
@@ -87,6 +121,7 @@ void Memory::write_byte(uint16_t addr, uint8_t v)
 { /* TODO: Account for new bank modes! */
   if(logmemrw){D("[MEM  W] $%04X:%02X\n",addr,v);};
   uint16_t page = addr&0xff00;
+  uint8_t  sid;
   /* ZeroPage ~ $0000/$00ff */
   if (page == kAddrZeroPage)
   {
@@ -111,44 +146,15 @@ void Memory::write_byte(uint16_t addr, uint8_t v)
       mem_ram_[addr] = v; /* Write to RAM */
     }
   }
-  /* SID ~ $d400/$d7ff */
+  /* SID ~ $d400/$d7ff and $de00/$dfff, decoded per 32 byte slot */
   else if (page >= kAddrSIDFirstPage
-        && page <= kAddrSIDLastPage)
+        && page <= kAddrIO2Page
+        && (sid = sid_slot(addr)) != kSIDNone
+        && c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kIO)
   {
-    if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kIO) {
-      if (page == kAddrSIDFirstPage) {
-        mem_ram_[addr] = v; /* Always write to RAM */
-        if(logsidiorw){D("[SIDIO W] $%04X:%02X\n",addr,v);};
-        /* Check SID address in reverse order */
-        if (((addr & kSIDFourMask) >= kAddrSIDFour)
-          && (addr & kSIDFourMask) < (kAddrSIDFour+0x20)) { /* SID Four */
-            c64_->sid_->write_register((uint8_t)(addr&0x1F), v, 3);
-        } else
-        if (((addr & kSIDThreeMask) >= kAddrSIDThree)
-          && (addr & kSIDThreeMask) < kAddrSIDFour) { /* SID Three */
-            c64_->sid_->write_register((uint8_t)(addr&0x1F), v, 2);
-        } else
-        if (((addr & kSIDTwoMask) >= kAddrSIDTwo)
-          && (addr & kSIDTwoMask) < kAddrSIDThree) { /* SID Two */
-            c64_->sid_->write_register((uint8_t)(addr&0x1F), v, 1);
-        } else
-        if (((addr & kSIDOneMask) >= kAddrSIDOne)
-          && (addr & kSIDOneMask) < kAddrSIDTwo) { /* SID One */
-            c64_->sid_->write_register((uint8_t)(addr&0x1F), v, 0);
-        }
-      } else
-      if (page == kAddrSIDSecondPage) {
-        if (((addr & kSIDOneMask) >= kAddrSIDOdd1)
-          && (addr & kSIDOneMask) < (kAddrSIDOdd1+0x20)) { /* SID Odd 1 == Second SID */
-            c64_->sid_->write_register((uint8_t)(addr&0x1F), v, 1);
-        }
-      } else {
-        mem_ram_[addr] = v; /* Write to RAM */
-      }
-    }
-    else {
-      mem_ram_[addr] = v; /* Write to RAM */
-    }
+    mem_ram_[addr] = v; /* Always write to RAM */
+    if(logsidiorw){D("[SIDIO W] $%04X:%02X\n",addr,v);};
+    c64_->sid_->write_register((uint8_t)(addr&0x1F), v, sid);
   }
   /* CIA1 ~ $dc00/$dcff */
   else if (page == kAddrCIA1Page)
@@ -206,6 +212,7 @@ uint8_t Memory::read_byte(uint16_t addr)
 { /* TODO: Account for new bank modes! */
   uint8_t  retval = 0;
   uint16_t page   = addr&0xff00;
+  uint8_t  sid;
   /* RAM ~ $1000/$1fff */
   if (page >= kAddrRAM1FirstPage
         && page <= kAddrRAM1LastPage)
@@ -233,11 +240,7 @@ uint8_t Memory::read_byte(uint16_t addr)
    && page <= kAddrBasicLastPage)
   {
     if (c64_->pla_->memory_banks(PLA::kBankBasic) == PLA::kROM) {
-      #if DESKTOP
-      retval = mem_rom_[addr]; /* Read from ROM */
-      #elif EMBEDDED
-      retval = c64_->basic_[(addr-kAddrBasicFirstPage)]; /* Read from ROM */
-      #endif
+      retval = basic_rom_[(addr-kAddrBasicFirstPage)]; /* Read from ROM */
     } else if (c64_->pla_->memory_banks(PLA::kBankBasic) == PLA::kCHI && c64_->cart_en()) {
       // retval = kCARTRomHi1[(addr-kAddrCartH1FirstPage)]; /* TODO: Move to Cart? */
       retval = c64_->cart_->read_register(addr);
@@ -263,55 +266,25 @@ uint8_t Memory::read_byte(uint16_t addr)
       retval = c64_->vic_->read_register(addr&0x7f);
       if (logvicrw) {D("[VIC R] $%04X:%02X\n",addr,retval);};
     } else if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kROM) {
-      #if DESKTOP
-      retval = mem_rom_[addr]; /* Read from ROM */
-      #elif EMBEDDED
-      retval = c64_->chargen_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
-      #endif
+      retval = chargen_rom_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
     } else {
       retval = mem_ram_[addr]; /* Read from RAM */
     }
   }
-  /* SID ~ $d400/$d7ff */
+  /* SID ~ $d400/$d7ff and $de00/$dfff, decoded per 32 byte slot */
+  else if (page >= kAddrSIDFirstPage
+        && page <= kAddrIO2Page
+        && (sid = sid_slot(addr)) != kSIDNone
+        && c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kIO)
+  {
+    retval = c64_->sid_->read_register((uint8_t)(addr&0x1F), sid);
+  }
+  /* Unmapped SID space or Character ROM ~ $d400/$d7ff */
   else if (page >= kAddrSIDFirstPage
         && page <= kAddrSIDLastPage)
   {
-    if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kIO) {
-      if (page == kAddrSIDFirstPage) { /* No SID's in second page */
-        /* Check SID address in reverse order */
-        if (((addr & kSIDFourMask) >= kAddrSIDFour)
-          && (addr & kSIDFourMask) < (kAddrSIDFour+0x20)) { /* SID Four */
-            retval = c64_->sid_->read_register((uint8_t)(addr&0x1F), 3);
-        } else
-        if (((addr & kSIDThreeMask) >= kAddrSIDThree)
-          && (addr & kSIDThreeMask) < kAddrSIDFour) { /* SID Three */
-            retval = c64_->sid_->read_register((uint8_t)(addr&0x1F), 2);
-        } else
-        if (((addr & kSIDTwoMask) >= kAddrSIDTwo)
-          && (addr & kSIDTwoMask) < kAddrSIDThree) { /* SID Two */
-            retval = c64_->sid_->read_register((uint8_t)(addr&0x1F), 1);
-        } else
-        if (((addr & kSIDOneMask) >= kAddrSIDOne)
-          && (addr & kSIDOneMask) < kAddrSIDTwo) { /* SID One */
-            retval = c64_->sid_->read_register((uint8_t)(addr&0x1F), 0);
-        } else {
-          retval = mem_ram_[addr]; /* Read from RAM */
-        }
-      } else
-      if (page == kAddrSIDSecondPage) {
-        if (((addr & kSIDOneMask) >= kAddrSIDOdd1)
-          && (addr & kSIDOneMask) < (kAddrSIDOdd1+0x20)) { /* SID Odd 1 == Second SID */
-            retval = c64_->sid_->read_register((uint8_t)(addr&0x1F), 1);
-        }
-      } else {
-        retval = mem_ram_[addr]; /* Read from RAM */
-      }
-    } else if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kROM) {
-      #if DESKTOP
-      retval = mem_rom_[addr]; /* Read from ROM */
-      #elif EMBEDDED
-      retval = c64_->chargen_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
-      #endif
+    if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kROM) {
+      retval = chargen_rom_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
     } else {
       retval = mem_ram_[addr]; /* Read from RAM */
     }
@@ -321,11 +294,7 @@ uint8_t Memory::read_byte(uint16_t addr)
         && page <= kAddrColorLastPage)
   {
     if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kROM) {
-      #if DESKTOP
-      retval = mem_rom_[addr]; /* Read from ROM */
-      #elif EMBEDDED
-      retval = c64_->chargen_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
-      #endif
+      retval = chargen_rom_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
     } else {
       retval = mem_ram_[addr]; /* Read from RAM */
     }
@@ -336,11 +305,7 @@ uint8_t Memory::read_byte(uint16_t addr)
     if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kIO && c64_->cia1_en()) {
       retval = c64_->cia1_->read_register(addr&0x0f);
     } else if (c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kROM) {
-      #if DESKTOP
-      retval = mem_rom_[addr]; /* Read from ROM */
-      #elif EMBEDDED
-      retval = c64_->chargen_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
-      #endif
+      retval = chargen_rom_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
     } else {
       retval = mem_ram_[addr]; /* Read from RAM */
     }
@@ -352,11 +317,7 @@ uint8_t Memory::read_byte(uint16_t addr)
     if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kIO && c64_->cia2_en()) {
       retval = c64_->cia2_->read_register(addr&0x0f);
     } else if (c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kROM) {
-      #if DESKTOP
-      retval = mem_rom_[addr]; /* Read from ROM */
-      #elif EMBEDDED
-      retval = c64_->chargen_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
-      #endif
+      retval = chargen_rom_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
     } else {
       retval = mem_ram_[addr];
     }
@@ -366,11 +327,7 @@ uint8_t Memory::read_byte(uint16_t addr)
   else if (page == kAddrIO1Page)
   {
     if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kROM) {
-      #if DESKTOP
-      retval = mem_rom_[addr]; /* Read from ROM */
-      #elif EMBEDDED
-      retval = c64_->chargen_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
-      #endif
+      retval = chargen_rom_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
     } else if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kIO) {
       /* hack for mc68b60 acia on cart */
       if (c64_->acia && c64_->cart_en()) {
@@ -388,11 +345,7 @@ uint8_t Memory::read_byte(uint16_t addr)
   else if (page == kAddrIO2Page)
   {
     if(c64_->pla_->memory_banks(PLA::kBankChargen) == PLA::kROM) {
-      #if DESKTOP
-      retval = mem_rom_[addr]; /* Read from ROM */
-      #elif EMBEDDED
-      retval = c64_->chargen_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
-      #endif
+      retval = chargen_rom_[(addr-kAddrCharsFirstPage)]; /* Read from ROM */
     } else {
       retval = mem_ram_[addr]; /* Read from RAM */
     }
@@ -403,11 +356,7 @@ uint8_t Memory::read_byte(uint16_t addr)
         && page <= kAddrKernalLastPage)
   {
     if (c64_->pla_->memory_banks(PLA::kBankKernal) == PLA::kROM) {
-      #if DESKTOP
-      retval = mem_rom_[addr]; /* Read from ROM */
-      #elif EMBEDDED
-      retval = c64_->kernal_[(addr-kAddrKernalFirstPage)]; /* Read from ROM */
-      #endif
+      retval = kernal_rom_[(addr-kAddrKernalFirstPage)]; /* Read from ROM */
     } else if (c64_->pla_->memory_banks(PLA::kBankKernal) == PLA::kCHI && c64_->cart_en()) { /* Was kBankBasic ?? */
       // retval = kCARTRomHi2[(addr-kAddrCartH2FirstPage)]; /* TODO: Move to Cart? */
       retval = c64_->cart_->read_register(addr);
@@ -489,11 +438,7 @@ uint8_t Memory::vic_read_byte(uint16_t addr)
   uint16_t vic_addr = c64_->cia2_->vic_base_address() + (addr & 0x3fff);
   if((vic_addr >= 0x1000 && vic_addr <  0x2000) ||
      (vic_addr >= 0x9000 && vic_addr <  0xa000)) {
-    #if DESKTOP
-    v = mem_rom_[kBaseAddrChars + (vic_addr & 0xfff)];
-    #elif EMBEDDED
-    v = c64_->chargen_[/* kBaseAddrChars +  */(vic_addr & 0xfff)];
-    #endif
+    v = chargen_rom_[(vic_addr & 0xfff)];
   } else {
     v = read_byte_no_io(vic_addr);
   }
@@ -502,30 +447,61 @@ uint8_t Memory::vic_read_byte(uint16_t addr)
 }
 
 /**
- * @brief loads a external binary into ROM
+ * @brief loads a ROM image from rom_path
+ * The image must be exactly size bytes
  */
-bool Memory::load_rom(const std::string &f, uint16_t baseaddr)
+bool Memory::load_rom(const std::string &f, uint8_t *rom, size_t size)
 {
   #if DESKTOP
-  // std::string path = "./assets/roms/" + f;
-  std::string path = "./assets/" + f;
+  std::string path = rom_path + "/" + f;
   std::ifstream is(path, std::ios::in | std::ios::binary);
   if(is)
   {
     is.seekg (0, is.end);
     std::streamoff length = is.tellg();
     is.seekg (0, is.beg);
-    is.read ((char *) &mem_rom_[baseaddr],length);
-    return true;
+    if (length != (std::streamoff)size) return false;
+    is.read ((char *) rom,length);
+    return (bool)is;
   }
   return false;
   #elif EMBEDDED
   (void)f;
-  (void)baseaddr;
+  (void)rom;
+  (void)size;
   return true;
   #endif
 }
 
+#if DESKTOP
+/**
+ * @brief replace the built-in ROM images with the ones in rom_path
+ * Images that are missing or have the wrong size stay built-in
+ */
+void Memory::load_roms()
+{
+  rom_override_ = new uint8_t[kBasicSize + kChargenSize + kKernalSize];
+  uint8_t *basic   = rom_override_;
+  uint8_t *chargen = (basic + kBasicSize);
+  uint8_t *kernal  = (chargen + kChargenSize);
+  if (load_rom("basic.901226-01.bin", basic, kBasicSize)) {
+    basic_rom_ = basic;
+  } else {
+    fprintf(stderr, "[MEM] No BASIC ROM in %s, using the built-in image\n", rom_path.c_str());
+  }
+  if (load_rom("characters.901225-01.bin", chargen, kChargenSize)) {
+    chargen_rom_ = chargen;
+  } else {
+    fprintf(stderr, "[MEM] No character ROM in %s, using the built-in image\n", rom_path.c_str());
+  }
+  if (load_rom("kernal.901227-03.bin", kernal, kKernalSize)) {
+    kernal_rom_ = kernal;
+  } else {
+    fprintf(stderr, "[MEM] No KERNAL ROM in %s, using the built-in image\n", rom_path.c_str());
+  }
+}
+#endif
+
 /**
  * @brief loads a external binary into RAM
  */
@@ -550,6 +526,17 @@ bool Memory::load_ram(const std::string &f, uint16_t baseaddr)
   #endif
 }
 
+#if DESKTOP
+/**
+ * @brief save or restore RAM, color RAM included
+ * ROM is covered by the snapshot key
+ */
+void Memory::snapshot(Snapshot &s)
+{
+  s.io(mem_ram_, kMemSize);
+}
+#endif
+
 // debug ////////////////////////////////////////////////////////////////////
 
 /**
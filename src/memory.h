@@ -55,11 +55,17 @@
 class Memory
 {
   private:
-    /* ROM & RAM */
+    /* RAM */
     uint8_t *mem_ram_;
-    uint8_t *mem_rom_;
-    uint8_t *mem_rom_cia1_;
-    uint8_t *mem_rom_cia2_;
+
+    /* ROM images, mapped read-only by pointer */
+    const uint8_t *basic_rom_;
+    const uint8_t *chargen_rom_;
+    const uint8_t *kernal_rom_;
+    #if DESKTOP
+    uint8_t *rom_override_; /* images loaded from rom_path */
+    void load_roms();
+    #endif
 
     /* Main pointer */
     C64 * c64_;
@@ -81,6 +87,9 @@ class Memory
 
     /* Memory pointer */
     uint8_t *mem_ram(void) {return mem_ram_;};
+    const uint8_t *basic_rom(void) {return basic_rom_;};
+    const uint8_t *chargen_rom(void) {return chargen_rom_;};
+    const uint8_t *kernal_rom(void) {return kernal_rom_;};
 
     /* read/write memory */
     uint8_t read_byte(uint16_t addr);
@@ -92,12 +101,20 @@ class Memory
     void write_word(uint16_t addr, uint16_t v);
     void write_word_no_io(uint16_t addr, uint16_t v);
 
+    /* SID layout from the PSID header */
+    void sid_layout(const uint16_t *addr, int sids);
+
     /* vic memory access */
     uint8_t vic_read_byte(uint16_t addr);
     uint8_t read_byte_rom(uint16_t addr);
 
+    #if DESKTOP
+    /* boot snapshot */
+    void snapshot(Snapshot &s);
+    #endif
+
     /* load external binaries */
-    bool load_rom(const std::string &f, uint16_t baseaddr);
+    bool load_rom(const std::string &f, uint8_t *rom, size_t size);
     bool load_ram(const std::string &f, uint16_t baseaddr);
 
     /* debug */
@@ -144,6 +161,12 @@ class Memory
     /* constants */
     static const size_t kMemSize = 0x10000;
     static const size_t kPageSize = 0x100;
+    static const size_t kBasicSize = 0x2000;
+    static const size_t kChargenSize = 0x1000;
+    static const size_t kKernalSize = 0x2000;
+    #if DESKTOP
+    static std::string rom_path; /* directory with replacement ROM images */
+    #endif
 
     /* memory addresses  */
     static const uint16_t kBaseAddrBasic       = 0xa000; /* -> 0xbfff */
@@ -205,25 +228,12 @@ class Memory
     static const uint16_t kAddrKernalFirstPage = 0xe000;
     static const uint16_t kAddrKernalLastPage  = 0xff00;
 
-    /* Number of SID vs memory layout configuration */
-    uint16_t kSIDOneMask   = 0xff1f;
-    uint16_t kSIDTwoMask   = 0xff3f;
-    uint16_t kSIDThreeMask = 0xff5f;
-    uint16_t kSIDFourMask  = 0xff7f;
-    uint16_t kAddrSIDOne   = 0xd400;
-    uint16_t kAddrSIDTwo   = 0xd420;
-    uint16_t kAddrSIDThree = 0xd440;
-    uint16_t kAddrSIDFour  = 0xd460;
-    uint16_t kAddrSIDOdd1  = 0xd500;
+    /* SID address decoding, one slot per 32 registers $d400 ~ $dfff */
+    static const int kMaxSIDs = 4;
+    static const int kSIDSlots = ((0xe000 - kAddrSIDFirstPage) >> 5);
+    static const uint8_t kSIDNone = 0xff;
 
     /* Public memory pointers set by Memory class */
-    /* CIA1 */
-    uint8_t *kCIA1MemWr; /* $dc00 */
-    uint8_t *kCIA1MemRd; /* $(dc)00 */
-    /* CIA2 */
-    uint8_t *kCIA2MemWr; /* $dd00 */
-    uint8_t *kCIA2MemRd; /* $(dd)00 */
-
     /* Cart ROM pointers */
     uint8_t *kCARTRomLo;  /* $8000 ~ $9fff */
     uint8_t *kCARTRomHi1; /* $a000 ~ $bfff */
@@ -232,6 +242,11 @@ class Memory
     /* Memory reusable masks */
     static const uint16_t HiAddrMask = 0xFF00;
     static const uint16_t LoAddrMask = 0xFF;
+
+  private:
+    /* SID index per slot, or kSIDNone for RAM/IO */
+    uint8_t sid_slot_[kSIDSlots];
+    uint8_t sid_slot(uint16_t addr){return sid_slot_[((addr - kAddrSIDFirstPage) >> 5)];};
 };
 
 
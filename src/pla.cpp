@@ -21,6 +21,7 @@
  */
 
 #include <c64.h>
+#include <snapshot.h>
 
 
 /**
@@ -297,22 +298,7 @@ void PLA::switch_banks(uint8_t v)
  */
 void PLA::setup_memory_banks(uint8_t v) // TODO: If havecart enable cartrom etc!
 {
-  /* load ROMs */
-  if (!l_basic) { /* Only load if not already loaded */
-    if (c64_->mem_->load_rom("roms/basic.901226-01.bin",Memory::kBaseAddrBasic)) {
-    l_basic = true; /* True for success / loaded */
-    } else { l_basic = false; } /* False for failed / not loaded */
-  }
-  if (!l_chargen) { /* Only load if not already loaded */
-    if (c64_->mem_->load_rom("roms/characters.901225-01.bin",Memory::kBaseAddrChars)) {
-      l_chargen = true; /* True for success / loaded */
-    } else { l_chargen = false; } /* False for failed / not loaded */
-  }
-  if (!l_kernal) { /* Only load if not already loaded */
-    if (c64_->mem_->load_rom("roms/kernal.901227-03.bin",Memory::kBaseAddrKernal)) {
-      l_kernal = true; /* True for success / loaded */
-    } else { l_kernal = false; } /* False for failed / not loaded */
-  }
+  /* ROMs are mapped by Memory */
 
   /* start with mode 0 and set everything to ram */
   for(size_t i=0 ; i < sizeof(banks_) ; i++) {
@@ -394,6 +380,13 @@ void PLA::emulate(void)
   /* Unused */
 }
 
+#if DESKTOP
+void PLA::snapshot(Snapshot &s)
+{
+  s.io(banks_);
+}
+#endif
+
 /* Debug functions */
 void PLA::logbanksetup(void)
 {
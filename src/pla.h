@@ -48,11 +48,6 @@ class PLA
     /* Cart yes or no? */
     bool havecart = false;
 
-    /* Roms loaded? */
-    bool l_basic   = false;
-    bool l_chargen = false;
-    bool l_kernal  = false;
-
     /* Memory banks */
     uint8_t data_direction_default = 0x2F; /* (https://www.c64-wiki.com/wiki/Zeropage) */
     uint8_t banks_at_boot = 0x1F;
@@ -175,6 +170,10 @@ class PLA
 
     void reset(void);
     void emulate(void);
+    #if DESKTOP
+    /* boot snapshot */
+    void snapshot(Snapshot &s);
+    #endif
 
     /* Debug logging */
     void setbanklogging(bool v){logplabank = v;};
@@ -0,0 +1,126 @@
+/*
+ * Lock-free single producer single consumer ring buffer
+ * Copyright (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * ringbuffer.h
+ *
+ * Made for emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_RINGBUFFER_H
+#define EMUDORE_RINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+
+
+/**
+ * @brief SPSC ring buffer
+ *
+ * Exactly one thread may produce and exactly one thread
+ * may consume. Slots are handed out in place so large
+ * records can be filled and drained without copying:
+ *
+ *  producer: acquire() -> fill slot -> publish()
+ *  consumer: front()   -> use slot  -> pop()
+ *            peek()    -> use run   -> pop(n)
+ *
+ * N must be a power of two.
+ */
+template <typename T, size_t N>
+class RingBuffer
+{
+  static_assert(N != 0 && (N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+
+  private:
+    T buffer_[N];
+    /* head_ is only written by the producer, tail_ only by the consumer */
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+
+  public:
+    /* producer side */
+    T *acquire()
+    {
+      size_t h = head_.load(std::memory_order_relaxed);
+      if(h - tail_.load(std::memory_order_acquire) == N)
+        return nullptr; /* full */
+      return &buffer_[h & (N - 1)];
+    };
+    void publish()
+    {
+      head_.store(head_.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_release);
+    };
+    bool push(const T &v)
+    {
+      T *slot = acquire();
+      if(slot == nullptr) return false;
+      *slot = v;
+      publish();
+      return true;
+    };
+
+    /* consumer side */
+    T *front()
+    {
+      size_t t = tail_.load(std::memory_order_relaxed);
+      if(t == head_.load(std::memory_order_acquire))
+        return nullptr; /* empty */
+      return &buffer_[t & (N - 1)];
+    };
+    void pop()
+    {
+      tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_release);
+    };
+    bool pop(T &v)
+    {
+      T *slot = front();
+      if(slot == nullptr) return false;
+      v = *slot;
+      pop();
+      return true;
+    };
+    /* consecutive slots ready to use, up to the end of the buffer */
+    size_t peek(T **run)
+    {
+      size_t t = tail_.load(std::memory_order_relaxed);
+      size_t n = head_.load(std::memory_order_acquire) - t;
+      size_t wrap = N - (t & (N - 1));
+      *run = &buffer_[t & (N - 1)];
+      return ((n < wrap) ? n : wrap);
+    };
+    void pop(size_t n)
+    {
+      tail_.store(tail_.load(std::memory_order_relaxed) + n,
+                  std::memory_order_release);
+    };
+
+    /* either side */
+    size_t size() const
+    {
+      return head_.load(std::memory_order_acquire)
+           - tail_.load(std::memory_order_acquire);
+    };
+    bool empty() const {return size() == 0;};
+    static constexpr size_t capacity() {return N;};
+    /* only safe while neither side is active */
+    void clear() {head_.store(0); tail_.store(0);};
+};
+
+
+#endif /* EMUDORE_RINGBUFFER_H */
@@ -22,10 +22,17 @@
 
 #if DESKTOP
 #include <time.h>
+#include <cstring>
+#include <thread>
 #endif
 
 #include <c64.h>
 #include <sidfile.h>
+#include <sidread.h>
+#if DESKTOP
+#include <sidsynth.h>
+#include <sidserver.h>
+#endif
 
 #if EMBEDDED
 extern "C" uint16_t cycled_delay_operation(uint16_t cycles);
@@ -39,11 +46,22 @@ extern "C" uint16_t cycled_delayed_write_operation(uint8_t address, uint8_t data
 extern "C" void reset_sid(void);
 #endif
 
-#if DESKTOP && !USBSID_DRIVER
+#if DESKTOP
+unsigned int Sid::sync_micros = Sid::kDefaultSyncMicros;
 #define NANO 1000000000L
 static double us_CPUcycleDuration = NANO / (float)cycles_per_sec;  /* CPU cycle duration in nanoseconds */
+/* transport idle time past a write's due time that counts as an underrun */
+static const auto kUnderrunSlack = std::chrono::milliseconds(1);
+
+size_t Sid::high_water = Sid::kDefaultHighWater;
+std::string Sid::record_file = "";
+std::string Sid::server_socket = "";
+std::string Sid::backend = "";
 #endif
 
+bool Sid::coalesce = false;
+bool Sid::hw_readback = false;
+
 unsigned int Sid::sid_main_clk = 0;
 unsigned int Sid::sid_flush_clk = 0;
 unsigned int Sid::sid_delay_clk = 0;
@@ -56,60 +74,310 @@ unsigned int Sid::sid_write_cycles = 0;
 Sid::Sid(C64 * c64) :
   c64_(c64)
 {
-#if USBSID_DRIVER
-  usbsid = new USBSID_NS::USBSID_Class();
-  if(usbsid->USBSID_Init(true, true) != 0) {
-    us_ = false;
-  } else {
-    usbsid->USBSID_SetClockRate(USBSID_NS::PAL, true);
-    us_ = true;
-  }
-#endif
-#if DESKTOP
-  srand(time(NULL));
-#endif
   sid_main_clk = sid_flush_clk = sid_delay_clk = sid_write_clk = sid_read_clk = 0;
   sid_read_cycles = sid_write_cycles = 0;
+  for (int c = 0; c < kShadowChips; c++)
+    for (int r = 0; r < 0x20; r++) shadow_[c][r] = kShadowUnknown;
+  coalesce_writes_ = coalesce_dropped_ = 0;
+  readback_ = new SidReadback();
+  reads_ = hw_reads_ = 0;
+
+#if DESKTOP
+  if (high_water == 0 || high_water > kQueueSize) high_water = kQueueSize;
+  throttle_ = new SidThrottle(Vic::kClockFrequency, sync_micros);
+  transport_clk_ = 0;
+  queued_ = depth_sum_ = 0;
+  depth_max_ = 0;
+  stalls_ = 0;
+  underruns_ = 0;
+  batches_ = batched_ = 0;
+  throttled_ = true;
+  rendering_ = false;
+  ticked_ = false;
+  synth_started_ = false;
+  synth_start_clk_ = 0;
+
+  /* the device, hardware first unless one is asked for */
+  std::string name = backend;
+  #if USBSID_DRIVER
+  if (name.empty()) name = "usbsid";
+  #else
+  if (name.empty()) name = "null";
+  #endif
+  if (name == "synth" && SidSynth::wav_file.empty()) SidSynth::play_audio = true;
+  device_ = SidBackend::create(name);
+  if (device_ == nullptr) {
+    fprintf(stderr, "[SID] Unknown backend %s, use one of: %s\n", name.c_str(), SidBackend::kNames);
+  } else if (!device_->ok()) {
+    delete device_;
+    device_ = nullptr;
+  }
+  if (device_ == nullptr) device_ = new NullBackend();
+  add_backend(device_);
+  /* software synthesis next to the device */
+  if ((!SidSynth::wav_file.empty() || SidSynth::play_audio) && !rendering_) {
+    add_backend(new SynthBackend());
+  }
+  if (!record_file.empty()) add_backend(new RecordBackend(record_file, Vic::kClockFrequency));
+  if (!server_socket.empty()) {
+    add_backend(new SidServer(server_socket, Vic::kClockFrequency, (Vic::kScreenLines * Vic::kLineCycles)));
+  }
+  D("[EMU] SID backend %s\n", device_->name());
+
+  running_.store(true);
+  threaded_ = true;
+  int error = pthread_create(&threadid_, NULL, &_Transport_Thread, this);
+  if (error != 0) {
+    /* fall back to hardware calls on the emulation thread */
+    fprintf(stderr, "[SID] Transport thread can't be created :[%s]\n", strerror(error));
+    threaded_ = false;
+  }
+#endif
 
   D("[EMU] SID adapter initialized.\n");
 }
 
 Sid::~Sid()
 {
-#if USBSID_DRIVER
-  if(us_) {
-    usbsid->USBSID_Reset();
-    usbsid->USBSID_Close();
-    delete usbsid;
-    us_ = false;
-  }
+#if DESKTOP
+  /* the transport drains the queue before it exits */
+  running_.store(false, std::memory_order_release);
+  if (threaded_) pthread_join(threadid_, NULL);
+  if (SidBackend::log_stats) report();
+  for (SidBackend *b : backends_) delete b;
+  delete throttle_;
 #endif
+  delete readback_;
+}
+
+#if DESKTOP
+/**
+ * @brief write pipeline statistics, -logsid
+ */
+void Sid::report()
+{
+  if (queued_ != 0) {
+    printf("[SID] %lu accesses queued, depth avg %.1f max %zu (high-water %zu), %u stalls, %u underruns\n",
+      queued_, ((double)depth_sum_ / queued_), depth_max_, high_water,
+      stalls_, underruns_.load());
+  }
+  if (batches_ != 0) {
+    printf("[SID] %lu writes submitted in %lu batches, avg %.1f\n",
+      batched_, batches_, ((double)batched_ / batches_));
+  }
+  if (throttle_->started()) {
+    printf("[SID] throttle speed %.3fx real time, synced every %u cycles, %u late resyncs\n",
+      speed(), throttle_->sync_cycles(), throttle_->late());
+  }
+  if (coalesce && coalesce_writes_ != 0 && transport_clk_ != 0) {
+    /* the cpu is gone by now, the transport saw the last cycle */
+    printf("[SID] coalescing dropped %lu of %lu writes (%.1f%%), %.1f writes/s saved\n",
+      coalesce_dropped_, coalesce_writes_,
+      ((100.0 * coalesce_dropped_) / coalesce_writes_),
+      (coalesce_dropped_ / ((double)transport_clk_ / Vic::kClockFrequency)));
+  }
+  if (reads_ != 0) {
+    printf("[SID] %lu reads, %lu from the chip\n", reads_, hw_reads_);
+  }
 }
+#endif
 
 void Sid::reset()
 {
   sid_main_clk = sid_flush_clk = sid_delay_clk = sid_write_clk = sid_read_clk = c64_->cpu_->cycles();
   sid_read_cycles = sid_write_cycles = 0;
+  for (int c = 0; c < kShadowChips; c++)
+    for (int r = 0; r < 0x20; r++) shadow_[c][r] = kShadowUnknown;
+  readback_->reset();
   // TODO: Reset memory registers to 0
-  #if DESKTOP && USBSID_DRIVER
-  if (us_) usbsid->USBSID_Reset();
+  #if DESKTOP
+  queue(SidWrite::kReset, 0, 0, 0);
   #elif EMBEDDED
   reset_sid();
   #endif
 }
 
-#if DESKTOP && !USBSID_DRIVER
-uint_fast64_t Sid::wait_ns(unsigned int cycles)
-{ auto start = std::chrono::steady_clock::now();
-  auto duration_ns = duration_t((long)(cycles * us_CPUcycleDuration));
-  auto target_time = (start + duration_ns);
+#if DESKTOP
+double Sid::speed()
+{
+  return throttle_->speed();
+}
+#endif
+
+#if DESKTOP
+// write pipeline ////////////////////////////////////////////////////////////
+
+/**
+ * @brief record a SID access for the transport thread
+ *
+ * Only blocks when high_water accesses are still waiting
+ */
+void Sid::queue(uint8_t kind, uint8_t chip, uint8_t reg, uint8_t value)
+{
+  size_t depth = queue_.size();
+  if (depth >= high_water) {
+    stalls_++;
+    while((depth = queue_.size()) >= high_water)
+      std::this_thread::yield();
+  }
+  SidWrite *w = queue_.acquire();
+  w->cycle = c64_->cpu_->cycles();
+  w->kind = kind;
+  w->chip = chip;
+  w->reg = reg;
+  w->value = value;
+  queue_.publish();
+  queued_++;
+  depth_sum_ += depth;
+  if (depth > depth_max_) depth_max_ = depth;
+  if (!threaded_) {
+    queue_.pop(transport(queue_.front(), 1));
+  }
+}
 
-  do {
-  } while (std::chrono::steady_clock::now() < target_time);
+/**
+ * @brief hand a backend its share of the accesses
+ * The first one added is the device, a synth marks the
+ * output as rendered so the throttle and -wavlen apply
+ */
+void Sid::add_backend(SidBackend *b)
+{
+  if (!b->ok()) {
+    delete b;
+    return;
+  }
+  if (b->clocked()) throttled_ = false;
+  if (b->ticked()) ticked_ = true;
+  if (!strcmp(b->name(), "synth")) rendering_ = true;
+  backends_.push_back(b);
+}
 
-  auto end = std::chrono::steady_clock::now();
-  auto actual_ns = static_cast<long long>(std::chrono::duration_cast<duration_t>(end - start).count());
-  return (uint_fast64_t)actual_ns;
+/**
+ * @brief read a register from the device
+ * Waits for the transport to deliver the queued writes first
+ */
+bool Sid::hardware_read(uint8_t sidno, uint8_t reg, uint8_t &v)
+{
+  while (threaded_ && !queue_.empty()) std::this_thread::yield();
+  return device_->read(sidno, reg, v);
+}
+
+/**
+ * @brief throttle up to cycle when no backend keeps time
+ */
+void Sid::pace(unsigned int cycle)
+{
+  unsigned int cycles = (cycle - transport_clk_);
+  if ((int)cycles < 0) cycles = 0; /* cpu clock was reset */
+  transport_clk_ = cycle;
+  if (throttled_) throttle_->throttle(cycles);
+}
+
+/**
+ * @brief forward queued accesses to the backends
+ *
+ * A run of writes goes out with one submit() per backend,
+ * anything else is handled on its own.
+ *
+ * @return the number of accesses consumed
+ */
+size_t Sid::transport(const SidWrite *w, size_t n)
+{
+  size_t writes = 0;
+  while (writes < n && w[writes].kind == SidWrite::kWrite) writes++;
+  if (writes != 0) {
+    pace(w[writes - 1].cycle);
+    for (SidBackend *b : backends_) b->submit(w, writes);
+    batches_++;
+    batched_ += writes;
+    return writes;
+  }
+  switch (w->kind) {
+    case SidWrite::kFlush:
+    case SidWrite::kClock:
+      pace(w->cycle);
+      for (SidBackend *b : backends_) b->flush(w->cycle);
+      break;
+    case SidWrite::kResync:
+      transport_clk_ = w->cycle;
+      for (SidBackend *b : backends_) b->resync(w->cycle);
+      break;
+    case SidWrite::kReset:
+      transport_clk_ = w->cycle;
+      for (SidBackend *b : backends_) b->reset(w->cycle);
+      break;
+    case SidWrite::kChip:
+      for (SidBackend *b : backends_) b->chip(w->chip, (0xd000 | (w->reg << 4)), w->value);
+      break;
+    default:
+      break;
+  }
+  return 1;
+}
+
+/**
+ * @brief frame tick for the backends that ask for it
+ * Called every frame so synth output and server frames continue
+ * between writes, stops the emulation once SidSynth::seconds
+ * are rendered
+ */
+void Sid::sync_clock()
+{
+  if (!ticked_) return;
+  unsigned int now = c64_->cpu_->cycles();
+  queue(SidWrite::kClock, 0, 0, 0);
+  if (!rendering_) return;
+  if (!synth_started_) {
+    synth_started_ = true;
+    synth_start_clk_ = now;
+  }
+  if (SidSynth::seconds != 0
+      && (now - synth_start_clk_) >= ((uint64_t)SidSynth::seconds * SidSynth::kClock)) {
+    c64_->disable_looping();
+  }
+}
+
+/**
+ * @brief chip layout from the PSID header
+ * @param type PSID chip type, 2 is 8580, anything else 6581
+ * Selects the synth model and describes the recorded stream
+ */
+void Sid::chip_info(uint8_t sidno, int type, uint16_t addr)
+{
+  readback_->model(sidno, (type == 2));
+  queue(SidWrite::kChip, sidno, ((addr >> 4) & 0xff), type);
+}
+
+void *Sid::transport_thread(void)
+{
+  pthread_setname_np(pthread_self(), "SID Transport");
+  unsigned int idle = 0;
+  auto idle_since = std::chrono::steady_clock::now();
+
+  while (true) {
+    SidWrite *run;
+    size_t n = queue_.peek(&run);
+    if (n == 0) {
+      /* drain everything before leaving */
+      if (!running_.load(std::memory_order_acquire)) break;
+      if (idle++ == 0) idle_since = std::chrono::steady_clock::now();
+      /* spin briefly, then give the core away */
+      if (idle < 64) continue;
+      if (idle < 1024) std::this_thread::yield();
+      else std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+    if (idle != 0 && run->kind == SidWrite::kWrite && !rendering_) {
+      /* the queue ran dry for longer than the gap to this write */
+      auto gap = duration_t((long)((run->cycle - transport_clk_) * us_CPUcycleDuration));
+      if ((std::chrono::steady_clock::now() - idle_since) > (gap + kUnderrunSlack)) {
+        underruns_++;
+      }
+    }
+    idle = 0;
+    queue_.pop(transport(run, n));
+  }
+  return NULL;
 }
 #endif
 
@@ -124,29 +392,23 @@ void Sid::sid_flush()
     sid_write_cycles = 0;
     sid_main_clk = sid_flush_clk = now;
     sid_delay_clk = sid_write_clk = sid_read_clk = now;
+    #if DESKTOP
+    queue(SidWrite::kResync, 0, 0, 0);
+    #endif
     return;
   }
+  #if DESKTOP
+  (void)cycles; /* the transport waits from its own clock */
+  queue(SidWrite::kFlush, 0, 0, 0);
+  #elif EMBEDDED
   while(cycles > 0xFFFF) {
     // printf("SID Flush called @ %u cycles (cycles >= 0xFFFF), last was at %u, diff %u, main clock %u\n",
     //   now, sid_flush_clk, cycles, sid_main_clk);
     cycles -= 0xFFFF;
-    #if DESKTOP && USBSID_DRIVER
-    usbsid->USBSID_WaitForCycle(0xFFFF);
-    #elif EMBEDDED
     if (C64::is_rsid) { cycled_delay_operation(0xFFFF); }
-    #else
-    wait_ns(0xFFFF);
-    #endif
   }
-  // if (int(cycles - (sid_write_cycles+sid_read_cycles)) > 0) {
-    #if DESKTOP && USBSID_DRIVER
-    usbsid->USBSID_WaitForCycle(cycles);
-    #elif EMBEDDED
-    if (C64::is_rsid) { cycled_delay_operation(cycles); }
-    #else
-    wait_ns(cycles);// - (sid_write_cycles+sid_read_cycles));
-    #endif
-  // }
+  if (C64::is_rsid) { cycled_delay_operation(cycles); }
+  #endif
   sid_main_clk = sid_delay_clk = sid_flush_clk = now;
   sid_read_cycles = sid_write_cycles = 0;
   return;
@@ -158,43 +420,48 @@ unsigned int Sid::sid_delay()
   #endif
   unsigned int now = c64_->cpu_->cycles();
   unsigned int cycles = (now - /* sid_delay_clk */sid_main_clk);
+  #if EMBEDDED /* desktop waits are done by the transport */
   while (cycles > 0xFFFF) {
     /* printf("SID delay called @ %u cycles (cycles > 0xFFFF), last was at %u, diff %u, main clock %u\n",
       now, sid_delay_clk, cycles, sid_main_clk); */
     cycles -= 0xFFFF;
-    #if DESKTOP && USBSID_DRIVER
-    usbsid->USBSID_WaitForCycle(0xFFFF);
-    #elif EMBEDDED
     if (C64::is_rsid) { cycled_delay_operation(0xFFFF); }
-    #else
-    wait_ns(0xFFFF);
-    #endif
   }
+  #endif
   sid_main_clk /* = sid_delay_clk */ = now;
   return cycles;
 }
 
+/**
+ * @brief read a SID register
+ *
+ * Reads are answered by the readback model, only the paddle
+ * registers or every register with hw_readback go to the chip.
+ */
 uint8_t Sid::read_register(uint8_t r, uint8_t sidno)
 {
   uint8_t v = 0;
+  uint8_t reg = r;
   r = ((sidno*0x20) | r);
   unsigned int cycles = sid_delay();
-  #if DESKTOP
-  if (r>=0x1B||r<=0x1C) {
-    // if (c64_->mem_->read_byte_no_io(r) == 0) {
-      v = (uint8_t)(rand()&0xFF);
-    // } else {
-      // v = c64_->mem_->read_byte_no_io(r);
-    // }
-  } else {
-    v = c64_->mem_->read_byte_no_io(r);  /* No hardware SID reading */
-  }
-  #elif EMBEDDED
+  bool paddle = (reg == SidReadback::kPotX || reg == SidReadback::kPotY);
+  reads_++;
+  #if EMBEDDED
   if (C64::is_rsid) { cycled_delay_operation(cycles); }
-  v = cycled_read_operation(r,0);  /* no delay cycles */
-  // #else
-  /* wait_ns(cycles); */
+  if (hw_readback || paddle) {
+    v = cycled_read_operation(r,0);  /* no delay cycles */
+    hw_reads_++;
+  } else
+  #elif DESKTOP
+  if ((hw_readback || paddle) && hardware_read(sidno, reg, v)) {
+    hw_reads_++;
+  } else
   #endif
+  if (paddle) {
+    v = 0xff; /* no paddles connected */
+  } else {
+    v = readback_->read(sidno, reg, c64_->cpu_->cycles());
+  }
   if (c64_->mem_->getlogrw(6)) {
     D("[RD%d] $%02X:%02X C:%u RDC:%u\n", sidno, r, v, cycles, sid_read_cycles);
   }
@@ -203,27 +470,45 @@ uint8_t Sid::read_register(uint8_t r, uint8_t sidno)
   return v;
 }
 
+/**
+ * @brief check a write against the shadow registers
+ *
+ * Rewriting a register with its current value does nothing on
+ * the chip, except for the voice control registers where the
+ * gate and test bits act on the write, those always pass.
+ * Dropped writes only shorten the stream, the remaining writes
+ * keep their cycle stamps.
+ *
+ * @return true if the write can be dropped
+ */
+bool Sid::coalesced(uint8_t sidno, uint8_t reg, uint8_t v)
+{
+  if (!coalesce || sidno >= kShadowChips) return false;
+  coalesce_writes_++;
+  bool control = (reg == 0x04 || reg == 0x0b || reg == 0x12);
+  if (!control && shadow_[sidno][reg] == v) {
+    coalesce_dropped_++;
+    return true;
+  }
+  shadow_[sidno][reg] = v;
+  return false;
+}
+
 void Sid::write_register(uint8_t r, uint8_t v, uint8_t sidno)
 {
   // sid_main_clk = sid_write_clk = c64_->cpu_->cycles();
   r = ((sidno*0x20) | r);
   unsigned int cycles = sid_delay();
-  #if DESKTOP && USBSID_DRIVER
-  if (us_) {
-    // if (!C64::is_rsid && c64_->io_->nosdl || C64::is_rsid)
-    // NOTE: DISABLED< DOESNT SEEM NEEDED WITH NEW DRIVER
-    // if(C64::is_rsid || c64_->io_->nosdl) {
-      // usbsid->USBSID_WaitForCycle(cycles);
-    // }
-    usbsid->USBSID_WriteRingCycled(r, v, cycles);
-  }
+  readback_->write(sidno, (r & 0x1F), v, c64_->cpu_->cycles());
+  bool drop = coalesced(sidno, (r & 0x1F), v);
+  #if DESKTOP
+  if (!drop) queue(SidWrite::kWrite, sidno, (r & 0x1F), v);
   #elif EMBEDDED
   // TODO: DIFFERENTIATE BETWEEN CYNTHCART AND SIDS AND THEN BETWEEN PSID AND RSID!
-  if (C64::C64::is_cynthcart) { cycled_write_operation(r,v,0); } /* no delay cycles needed, gets written when called! */
+  if (drop) { /* unchanged register */ }
+  else if (C64::C64::is_cynthcart) { cycled_write_operation(r,v,0); } /* no delay cycles needed, gets written when called! */
   // else (C64::is_rsid) { cycled_delay_operation(cycles); cycled_write_operation(r,v,cycles); }
   else { cycled_write_operation(r,v,0); } // TODO: TEST!
-  #else
-  wait_ns(cycles);
   #endif
   if (c64_->mem_->getlogrw(6)) {
     D("[WR%d] $%02X:%02X C:%u WRC:%u\n", sidno, r, v, cycles, sid_write_cycles);
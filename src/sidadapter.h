@@ -30,8 +30,15 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <time.h>
-#if USBSID_DRIVER /* USBSID_DRIVER=1 */
-#include <USBSID.h>
+#if DESKTOP
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+#include <ringbuffer.h>
+#include <sidbackend.h>
 #endif
 
 /**
@@ -46,11 +53,6 @@ class Sid
     C64 *c64_;
     typedef std::chrono::nanoseconds duration_t;   /* Duration in nanoseconds */
 
-    #if USBSID_DRIVER /* USBSID_DRIVER=1 */
-    USBSID_NS::USBSID_Class *usbsid;
-    bool us_ = false;
-    #endif
-
     static unsigned int sid_main_clk;
     static unsigned int sid_flush_clk;
     static unsigned int sid_delay_clk;
@@ -62,8 +64,63 @@ class Sid
 
     bool sid_playing = false;
 
-    #if DESKTOP && !USBSID_DRIVER
-    uint_fast64_t wait_ns(unsigned int cycles);
+    /**
+     * redundant write coalescing, shadow_ holds the last value
+     * written per register or kShadowUnknown after a reset
+     */
+    static constexpr int kShadowChips = 4;
+    static constexpr uint16_t kShadowUnknown = 0x100;
+    uint16_t shadow_[kShadowChips][0x20];
+    unsigned long coalesce_writes_;
+    unsigned long coalesce_dropped_;
+    bool coalesced(uint8_t sidno, uint8_t reg, uint8_t v);
+
+    /* register reads answered without the chip */
+    SidReadback *readback_;
+    unsigned long reads_;
+    unsigned long hw_reads_;
+
+    #if DESKTOP
+    /* wall clock throttle of the transport */
+    SidThrottle *throttle_;
+    #endif
+
+    #if DESKTOP
+    /**
+     * write pipeline, the emulation thread records accesses in
+     * queue_ and the transport thread does the hardware calls
+     */
+    static constexpr size_t kQueueSize = 4096;
+    RingBuffer<SidWrite,kQueueSize> queue_;
+    pthread_t threadid_;
+    std::atomic<bool> running_;
+    bool threaded_;
+    /* transport thread state */
+    unsigned int transport_clk_; /* cycle of the last access */
+    /* statistics */
+    unsigned long queued_;
+    unsigned long depth_sum_;
+    size_t depth_max_;
+    unsigned int stalls_;
+    std::atomic<unsigned int> underruns_;
+    unsigned long batches_;
+    unsigned long batched_;
+    /* the device and whatever listens along */
+    std::vector<SidBackend *> backends_;
+    SidBackend *device_;
+    bool throttled_;             /* no backend keeps real time */
+    bool rendering_;             /* a synth renders, -wavlen applies */
+    bool ticked_;                /* a backend wants frame ticks */
+    bool synth_started_;
+    unsigned int synth_start_clk_;
+
+    void add_backend(SidBackend *b);
+    void queue(uint8_t kind, uint8_t chip, uint8_t reg, uint8_t value);
+    size_t transport(const SidWrite *w, size_t n);
+    void pace(unsigned int cycle);
+    bool hardware_read(uint8_t sidno, uint8_t reg, uint8_t &v);
+    void *transport_thread(void);
+    void report(void);
     #endif
 
   public:
@@ -78,10 +135,42 @@ class Sid
     uint8_t read_register(uint8_t r, uint8_t sidno);
     void write_register(uint8_t r, uint8_t v, uint8_t sidno);
 
+    #if DESKTOP
+    void sync_clock(void);
+    void chip_info(uint8_t sidno, int type, uint16_t addr);
+    #endif
+
+    /* drop writes that don't change a register */
+    static bool coalesce;
+    /* read every register from the chip, not only the paddles */
+    static bool hw_readback;
+
     /* SID play workaround */
     void set_playing(bool playing) { sid_playing = playing; };
     bool isSIDplaying() { return sid_playing; };
 
+    #if DESKTOP
+    static void *_Transport_Thread(void *context)
+    { /* Required for supplying private function to pthread_create */
+      return ((Sid *)context)->transport_thread();
+    }
+
+    /* queued accesses before the emulation waits for the transport */
+    static size_t high_water;
+    static constexpr size_t kDefaultHighWater = 512;
+    /* record the register stream to this file */
+    static std::string record_file;
+    /* publish the register stream on this Unix socket */
+    static std::string server_socket;
+    /* device backend by name, empty picks usbsid or null */
+    static std::string backend;
+    /* emulated time per wall clock time, 1.0 is real time */
+    double speed();
+    /* wall clock sync interval of the throttle */
+    static unsigned int sync_micros;
+    static constexpr unsigned int kDefaultSyncMicros = SidThrottle::kDefaultSyncMicros;
+    #endif
+
 };
 
 #endif
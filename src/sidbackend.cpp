@@ -0,0 +1,363 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidbackend.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <util.h>
+#include <sidbackend.h>
+
+#if DESKTOP
+
+#include <cstring>
+#include <thread>
+
+#include <sidsynth.h>
+#include <sidstream.h>
+#include <usbsidmock.h>
+
+
+#if USBSID_DRIVER
+const char *SidBackend::kNames = "usbsid, usbsidmock, synth, null, mock";
+#else
+const char *SidBackend::kNames = "usbsidmock, synth, null, mock";
+#endif
+bool SidBackend::log_stats = false;
+
+/**
+ * @brief backend by its command line name
+ * @return nullptr for unknown names, check ok() on the rest
+ */
+SidBackend *SidBackend::create(const std::string &name)
+{
+  #if USBSID_DRIVER
+  if (name == "usbsid") return new UsbsidBackend<USBSID_NS::USBSID_Class>();
+  #endif
+  if (name == "usbsidmock") return new UsbsidBackend<UsbsidMock>();
+  if (name == "synth") return new SynthBackend();
+  if (name == "null") return new NullBackend();
+  if (name == "mock") return new MockBackend();
+  return nullptr;
+}
+
+/**
+ * @brief cycles since the previous access, 0 after a cpu reset
+ */
+unsigned int SidBackend::elapsed(unsigned int cycle)
+{
+  unsigned int cycles = (cycle - clk_);
+  clk_ = cycle;
+  return (((int)cycles < 0) ? 0 : cycles);
+}
+
+// throttle //////////////////////////////////////////////////////////////////
+
+SidThrottle::SidThrottle(uint32_t clock, unsigned int sync_micros) :
+  clock_(clock),
+  cycles_(0),
+  total_(0),
+  pending_(0),
+  late_(0),
+  resync_(true),
+  started_(false)
+{
+  sync_cycles_ = (unsigned int)(((uint64_t)sync_micros * clock) / 1000000);
+}
+
+void SidThrottle::throttle(unsigned int cycles)
+{
+  using namespace std::chrono;
+  cycles_ += cycles;
+  total_ += cycles;
+  pending_ += cycles;
+  if (pending_ < sync_cycles_) return;
+  pending_ = 0;
+  steady_clock::time_point now = steady_clock::now();
+  if (!started_) {
+    started_ = true;
+    start_ = now;
+    total_ = 0;
+  }
+  if (resync_) {
+    resync_ = false;
+    epoch_ = now;
+    cycles_ = 0;
+    return;
+  }
+  /* keep the epoch close so the nanosecond math can't overflow */
+  while (cycles_ >= clock_) {
+    cycles_ -= clock_;
+    epoch_ += seconds(1);
+  }
+  steady_clock::time_point deadline = epoch_ +
+    nanoseconds((cycles_ * 1000000000ULL) / clock_);
+  if ((now - deadline) > milliseconds(kMaxBehindMs)) {
+    resync_ = true;
+    late_++;
+    return;
+  }
+  std::this_thread::sleep_until(deadline - microseconds(kSpinMicros));
+  while (steady_clock::now() < deadline) {}
+}
+
+double SidThrottle::speed()
+{
+  using namespace std::chrono;
+  double wall = duration_cast<duration<double>>(steady_clock::now() - start_).count();
+  if (!started_ || wall <= 0) return 0;
+  return (((double)total_ / clock_) / wall);
+}
+
+// mock //////////////////////////////////////////////////////////////////////
+
+MockBackend::MockBackend() :
+  started_(false),
+  writes_(0),
+  batches_(0),
+  flushes_(0),
+  resets_(0),
+  batch_max_(0),
+  gap_min_(~0u),
+  gap_max_(0),
+  gap_sum_(0)
+{
+  memset(regs_, 0, sizeof(regs_));
+}
+
+MockBackend::~MockBackend()
+{
+  if (!log_stats || batches_ == 0) return;
+  printf("[MOCK] %lu writes in %lu batches, avg %.1f max %zu, %lu flushes, %lu resets\n",
+    writes_, batches_, ((double)writes_ / batches_), batch_max_, flushes_, resets_);
+  if (writes_ > 1) {
+    printf("[MOCK] cycles between writes min %u avg %.1f max %u\n",
+      gap_min_, ((double)gap_sum_ / (writes_ - 1)), gap_max_);
+  }
+}
+
+void MockBackend::submit(const SidWrite *w, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    unsigned int gap = elapsed(w[i].cycle);
+    if (started_) {
+      if (gap < gap_min_) gap_min_ = gap;
+      if (gap > gap_max_) gap_max_ = gap;
+      gap_sum_ += gap;
+    }
+    started_ = true;
+    regs_[(w[i].chip & 3)][(w[i].reg & 0x1f)] = w[i].value;
+  }
+  writes_ += n;
+  batches_++;
+  if (n > batch_max_) batch_max_ = n;
+}
+
+void MockBackend::flush(unsigned int cycle)
+{
+  flushes_++;
+  clk_ = cycle;
+}
+
+void MockBackend::reset(unsigned int cycle)
+{
+  resets_++;
+  memset(regs_, 0, sizeof(regs_));
+  clk_ = cycle;
+}
+
+/**
+ * @brief last value written, the mock has no oscillators
+ */
+bool MockBackend::read(uint8_t chip, uint8_t reg, uint8_t &v)
+{
+  v = regs_[(chip & 3)][(reg & 0x1f)];
+  return true;
+}
+
+// record ////////////////////////////////////////////////////////////////////
+
+RecordBackend::RecordBackend(const std::string &path, uint32_t clock)
+{
+  out_ = new SidStreamWriter(path, clock);
+}
+
+RecordBackend::~RecordBackend()
+{
+  delete out_;
+}
+
+bool RecordBackend::ok()
+{
+  return out_->ok();
+}
+
+void RecordBackend::submit(const SidWrite *w, size_t n)
+{
+  for (size_t i = 0; i < n; i++) out_->write(w[i].cycle, w[i].chip, w[i].reg, w[i].value);
+}
+
+void RecordBackend::flush(unsigned int cycle)
+{
+  out_->delay(cycle);
+}
+
+void RecordBackend::chip(uint8_t chip, uint16_t addr, uint8_t type)
+{
+  out_->describe(chip, addr, type);
+}
+
+// synth /////////////////////////////////////////////////////////////////////
+
+SynthBackend::SynthBackend()
+{
+  synth_ = new SidSynth();
+  if (SidSynth::force_model == 2) {
+    for (int n = 0; n < SidSynth::kMaxChips; n++) synth_->model(n, SidSynth::k8580);
+  }
+}
+
+SynthBackend::~SynthBackend()
+{
+  delete synth_;
+}
+
+bool SynthBackend::ok()
+{
+  return synth_->ok();
+}
+
+void SynthBackend::submit(const SidWrite *w, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    synth_->clock_to(w[i].cycle);
+    synth_->write(w[i].chip, w[i].reg, w[i].value);
+  }
+}
+
+void SynthBackend::flush(unsigned int cycle)
+{
+  synth_->clock_to(cycle);
+}
+
+void SynthBackend::reset(unsigned int cycle)
+{
+  synth_->clock_to(cycle);
+  synth_->reset();
+}
+
+/**
+ * @param type PSID chip type, 2 is 8580, anything else 6581
+ */
+void SynthBackend::chip(uint8_t chip, uint16_t addr, uint8_t type)
+{
+  (void)addr;
+  if (SidSynth::force_model >= 0) type = SidSynth::force_model;
+  synth_->model(chip, ((type == 2) ? SidSynth::k8580 : SidSynth::k6581));
+}
+
+// usbsid ////////////////////////////////////////////////////////////////////
+
+#if USBSID_DRIVER
+template <>
+UsbsidBackend<USBSID_NS::USBSID_Class>::UsbsidBackend()
+{
+  usbsid_ = new USBSID_NS::USBSID_Class();
+  ok_ = (usbsid_->USBSID_Init(true, true) == 0);
+  if (ok_) usbsid_->USBSID_SetClockRate(USBSID_NS::PAL, true);
+}
+
+template <>
+const char *UsbsidBackend<USBSID_NS::USBSID_Class>::name() {return "usbsid";}
+#endif
+
+template <>
+UsbsidBackend<UsbsidMock>::UsbsidBackend()
+{
+  usbsid_ = new UsbsidMock();
+  ok_ = (usbsid_->USBSID_Init(true, true) == 0);
+  if (ok_) usbsid_->USBSID_SetClockRate(UsbsidMock::PAL, true);
+}
+
+template <>
+const char *UsbsidBackend<UsbsidMock>::name() {return "usbsidmock";}
+
+template <class Driver>
+UsbsidBackend<Driver>::~UsbsidBackend()
+{
+  if (ok_) {
+    usbsid_->USBSID_Reset();
+    usbsid_->USBSID_Close();
+  }
+  delete usbsid_;
+}
+
+/* the mock counts flushes apart from the waits that split long gaps */
+template <class Driver>
+static void flushed(Driver *driver) {(void)driver;}
+static void flushed(UsbsidMock *mock) {mock->flushed();}
+
+/**
+ * @brief wait out whole chunks, the driver takes at most 0xFFFF
+ * cycles per call
+ * @return the cycles left, at most 0xFFFF
+ */
+template <class Driver>
+unsigned int UsbsidBackend<Driver>::wait(unsigned int cycles)
+{
+  while (cycles > 0xFFFF) {
+    cycles -= 0xFFFF;
+    usbsid_->USBSID_WaitForCycle(0xFFFF);
+  }
+  return cycles;
+}
+
+template <class Driver>
+void UsbsidBackend<Driver>::submit(const SidWrite *w, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    unsigned int cycles = wait(elapsed(w[i].cycle));
+    usbsid_->USBSID_WriteRingCycled(((w[i].chip * 0x20) | w[i].reg), w[i].value, cycles);
+  }
+}
+
+template <class Driver>
+void UsbsidBackend<Driver>::flush(unsigned int cycle)
+{
+  usbsid_->USBSID_WaitForCycle(wait(elapsed(cycle)));
+  flushed(usbsid_);
+}
+
+template <class Driver>
+void UsbsidBackend<Driver>::reset(unsigned int cycle)
+{
+  usbsid_->USBSID_Reset();
+  clk_ = cycle;
+}
+
+template <class Driver>
+bool UsbsidBackend<Driver>::read(uint8_t chip, uint8_t reg, uint8_t &v)
+{
+  v = usbsid_->USBSID_Read(((chip * 0x20) | reg));
+  return true;
+}
+
+#if USBSID_DRIVER
+template class UsbsidBackend<USBSID_NS::USBSID_Class>;
+#endif
+template class UsbsidBackend<UsbsidMock>;
+
+#endif /* DESKTOP */
@@ -0,0 +1,271 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidbackend.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_SIDBACKEND_H
+#define EMUDORE_SIDBACKEND_H
+
+#if DESKTOP
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#if USBSID_DRIVER
+#include <USBSID.h>
+#endif
+
+class SidSynth;
+class SidStreamWriter;
+class UsbsidMock;
+
+
+/**
+ * @brief SID access as recorded by the emulation thread
+ *
+ * The cycle is the cpu cycle of the access, backends turn the
+ * distance between records into cycle deltas.
+ */
+struct SidWrite
+{
+  unsigned int cycle;
+  uint8_t kind;
+  uint8_t chip;
+  uint8_t reg;   /* chip register, 0x00-0x1f */
+  uint8_t value;
+
+  enum kKind
+  {
+    kWrite,  /* register write */
+    kFlush,  /* wait until cycle */
+    kResync, /* restart the cycle count at cycle */
+    kReset,  /* reset the hardware */
+    kClock,  /* frame tick, only queued when a backend is ticked() */
+    kChip,   /* chip layout, PSID address byte in reg, model in value */
+  };
+};
+
+/**
+ * @brief where SID accesses end up
+ *
+ * The transport thread hands every backend the runs of writes
+ * it finds in the queue with one submit() call, anything else
+ * in the queue becomes one of the other calls. A backend keeps
+ * its own clock, clk_ is the cycle of the last access it saw.
+ *
+ * Backends that keep real time themselves (hardware, audio)
+ * report clocked(), without one the transport throttles. Those
+ * that need to hear about every frame, writes or not, report
+ * ticked() and get a flush() per frame.
+ */
+class SidBackend
+{
+  public:
+    SidBackend() : clk_(0) {};
+    virtual ~SidBackend() {};
+
+    virtual const char *name() = 0;
+    virtual bool ok() {return true;};
+    virtual bool clocked() {return false;};
+    virtual bool ticked() {return false;};
+
+    /* writes in queue order, all of kind kWrite */
+    virtual void submit(const SidWrite *w, size_t n) = 0;
+    /* no writes up to cycle */
+    virtual void flush(unsigned int cycle) {clk_ = cycle;};
+    virtual void resync(unsigned int cycle) {clk_ = cycle;};
+    virtual void reset(unsigned int cycle) {clk_ = cycle;};
+    virtual void chip(uint8_t /* chip */, uint16_t /* addr */, uint8_t /* type */) {};
+    /* register read from the device, false if it can't */
+    virtual bool read(uint8_t /* chip */, uint8_t /* reg */, uint8_t & /* v */) {return false;};
+
+    static SidBackend *create(const std::string &name);
+    static const char *kNames;
+    /* print statistics on destruction, -logsid */
+    static bool log_stats;
+
+  protected:
+    unsigned int clk_;
+    unsigned int elapsed(unsigned int cycle);
+};
+
+/**
+ * @brief keeps a stream of cycles in step with the wall clock
+ *
+ * Instead of spinning out every cycle delta the cycles are
+ * added up, every sync_cycles_ the caller sleeps to the
+ * absolute deadline of the emulated time and only spins the
+ * last kSpinMicros. Falling too far behind restarts the epoch
+ * instead of running a burst to catch up.
+ */
+class SidThrottle
+{
+  public:
+    SidThrottle(uint32_t clock, unsigned int sync_micros);
+
+    void throttle(unsigned int cycles);
+    /* emulated time per wall clock time, 1.0 is real time */
+    double speed();
+    bool started() {return started_;};
+    unsigned int late() {return late_;};
+    unsigned int sync_cycles() {return sync_cycles_;};
+
+    static constexpr unsigned int kDefaultSyncMicros = 1000;
+    static constexpr int kSpinMicros = 50;
+    static constexpr int kMaxBehindMs = 20;
+
+  private:
+    uint32_t clock_;
+    std::chrono::steady_clock::time_point epoch_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t cycles_;           /* cycles since epoch_ */
+    uint64_t total_;            /* cycles since start_ */
+    unsigned int pending_;      /* cycles since the last sync */
+    unsigned int sync_cycles_;
+    unsigned int late_;
+    bool resync_;
+    bool started_;
+};
+
+/**
+ * @brief drops everything
+ */
+class NullBackend : public SidBackend
+{
+  public:
+    const char *name() {return "null";};
+    void submit(const SidWrite *w, size_t n) {if (n != 0) clk_ = w[n - 1].cycle;};
+};
+
+/**
+ * @brief keeps what it is sent, for checking the write path
+ *
+ * Tracks the register values, batch sizes and the cycle gaps
+ * between writes are summed up on destruction.
+ */
+class MockBackend : public SidBackend
+{
+  public:
+    MockBackend();
+    ~MockBackend();
+
+    const char *name() {return "mock";};
+    void submit(const SidWrite *w, size_t n);
+    void flush(unsigned int cycle);
+    void reset(unsigned int cycle);
+    bool read(uint8_t chip, uint8_t reg, uint8_t &v);
+
+  private:
+    uint8_t regs_[4][0x20];
+    bool started_;
+    unsigned long writes_;
+    unsigned long batches_;
+    unsigned long flushes_;
+    unsigned long resets_;
+    size_t batch_max_;
+    unsigned int gap_min_;
+    unsigned int gap_max_;
+    uint64_t gap_sum_;
+};
+
+/**
+ * @brief register stream file, see SidStreamWriter
+ */
+class RecordBackend : public SidBackend
+{
+  public:
+    RecordBackend(const std::string &path, uint32_t clock);
+    ~RecordBackend();
+
+    const char *name() {return "record";};
+    bool ok();
+    void submit(const SidWrite *w, size_t n);
+    void flush(unsigned int cycle);
+    void resync(unsigned int cycle) {flush(cycle);};
+    void reset(unsigned int cycle) {flush(cycle);};
+    void chip(uint8_t chip, uint16_t addr, uint8_t type);
+
+  private:
+    SidStreamWriter *out_;
+};
+
+/**
+ * @brief built-in synth, see SidSynth
+ */
+class SynthBackend : public SidBackend
+{
+  public:
+    SynthBackend();
+    ~SynthBackend();
+
+    const char *name() {return "synth";};
+    bool ok();
+    bool clocked() {return true;}; /* renders unpaced or blocks on audio */
+    bool ticked() {return true;};  /* output continues between writes */
+    void submit(const SidWrite *w, size_t n);
+    void flush(unsigned int cycle);
+    void resync(unsigned int cycle) {flush(cycle);};
+    void reset(unsigned int cycle);
+    void chip(uint8_t chip, uint16_t addr, uint8_t type);
+
+  private:
+    SidSynth *synth_;
+};
+
+/**
+ * @brief USBSID-Pico hardware
+ *
+ * Writes go out with their cycle delta through the driver's
+ * ring, the device plays them in real time. Driver is the
+ * USBSID_Class of the driver library or UsbsidMock, which
+ * stands in for it without hardware.
+ */
+template <class Driver>
+class UsbsidBackend : public SidBackend
+{
+  public:
+    UsbsidBackend();
+    ~UsbsidBackend();
+
+    const char *name();
+    bool ok() {return ok_;};
+    bool clocked() {return true;};
+    void submit(const SidWrite *w, size_t n);
+    void flush(unsigned int cycle);
+    void reset(unsigned int cycle);
+    bool read(uint8_t chip, uint8_t reg, uint8_t &v);
+
+  private:
+    Driver *usbsid_;
+    bool ok_;
+    unsigned int wait(unsigned int cycles);
+};
+
+/* driver specific, in sidbackend.cpp */
+#if USBSID_DRIVER
+template <> UsbsidBackend<USBSID_NS::USBSID_Class>::UsbsidBackend();
+template <> const char *UsbsidBackend<USBSID_NS::USBSID_Class>::name();
+#endif
+template <> UsbsidBackend<UsbsidMock>::UsbsidBackend();
+template <> const char *UsbsidBackend<UsbsidMock>::name();
+
+#endif /* DESKTOP */
+
+#endif /* EMUDORE_SIDBACKEND_H */
@@ -11,6 +11,8 @@
 
 SidFile::SidFile()
 {
+    /* only PSID v3+ headers carry extra chips */
+    secondSID = thirdSID = fourthSID = 0;
 }
 
 /* Source: https://stackoverflow.com/a/2602885 */
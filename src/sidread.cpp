@@ -0,0 +1,238 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidread.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <util.h>
+#include <sidread.h>
+
+
+/* envelope rate counter periods per ADSR nibble */
+static const uint16_t kRatePeriod[16] = {
+  9, 32, 63, 95, 149, 220, 267, 313,
+  392, 977, 1954, 3126, 3907, 11720, 19532, 31251
+};
+
+/* cycles a value stays on the data bus */
+static const unsigned int kBusTTL6581 = 0x1d00;
+static const unsigned int kBusTTL8580 = 0xa2000;
+
+static const uint32_t kNoiseSeed = 0x7ffff8;
+
+SidReadback::SidReadback()
+{
+  for (int c = 0; c < kMaxChips; c++) bus_ttl_[c] = kBusTTL6581;
+  reset();
+  D("[EMU] SID readback initialized.\n");
+}
+
+void SidReadback::reset()
+{
+  for (int c = 0; c < kMaxChips; c++) {
+    bus_[c] = 0;
+    bus_clk_[c] = 0;
+    clk_[c] = 0;
+    acc_[c] = 0;
+    lfsr_[c] = kNoiseSeed;
+    freq_[c] = pw_[c] = 0;
+    ctrl_[c] = ad_[c] = sr_[c] = 0;
+    env_[c] = 0;
+    state_[c] = kRelease;
+    rate_cnt_[c] = 0;
+    exp_cnt_[c] = 0;
+    hold_zero_[c] = true;
+  }
+}
+
+void SidReadback::model(int chip, bool mos8580)
+{
+  if (chip < 0 || chip >= kMaxChips) return;
+  bus_ttl_[chip] = (mos8580 ? kBusTTL8580 : kBusTTL6581);
+}
+
+/**
+ * @brief a register write as seen on the bus
+ * Only the voice 3 registers change the model
+ */
+void SidReadback::write(int chip, uint8_t reg, uint8_t v, unsigned int cycle)
+{
+  if (chip < 0 || chip >= kMaxChips) return;
+  bus_[chip] = v;
+  bus_clk_[chip] = cycle;
+  if (reg < 0x0e || reg > 0x14) return;
+  clock(chip, cycle);
+  switch (reg) {
+    case 0x0e: freq_[chip] = ((freq_[chip] & 0xff00) | v); break;
+    case 0x0f: freq_[chip] = ((freq_[chip] & 0x00ff) | (v << 8)); break;
+    case 0x10: pw_[chip] = ((pw_[chip] & 0x0f00) | v); break;
+    case 0x11: pw_[chip] = ((pw_[chip] & 0x00ff) | ((v & 0x0f) << 8)); break;
+    case 0x12:
+      if (v & 0x08) { /* test bit holds the oscillator and noise */
+        acc_[chip] = 0;
+        lfsr_[chip] = kNoiseSeed;
+      }
+      if ((v & 0x01) && !(ctrl_[chip] & 0x01)) {
+        state_[chip] = kAttack;
+        hold_zero_[chip] = false;
+      } else if (!(v & 0x01) && (ctrl_[chip] & 0x01)) {
+        state_[chip] = kRelease;
+      }
+      ctrl_[chip] = v;
+      break;
+    case 0x13: ad_[chip] = v; break;
+    case 0x14: sr_[chip] = v; break;
+    default: break;
+  }
+}
+
+/**
+ * @brief value of a register read at cycle
+ */
+uint8_t SidReadback::read(int chip, uint8_t reg, unsigned int cycle)
+{
+  if (chip < 0 || chip >= kMaxChips) return 0;
+  uint8_t v;
+  switch (reg) {
+    case kOsc3:
+      clock(chip, cycle);
+      v = osc3(chip);
+      break;
+    case kEnv3:
+      clock(chip, cycle);
+      v = env_[chip];
+      break;
+    default:
+      return ((cycle - bus_clk_[chip]) < bus_ttl_[chip] ? bus_[chip] : 0);
+  }
+  bus_[chip] = v;
+  bus_clk_[chip] = cycle;
+  return v;
+}
+
+/**
+ * @brief run voice 3 up to cycle
+ *
+ * The oscillator is advanced in one step, the noise register
+ * is shifted once per rise of accumulator bit 19 and the
+ * envelope per rate counter period.
+ */
+void SidReadback::clock(int c, unsigned int cycle)
+{
+  unsigned int cycles = (cycle - clk_[c]);
+  clk_[c] = cycle;
+  if ((int)cycles <= 0) return; /* cpu clock was reset */
+  if (!(ctrl_[c] & 0x08)) {
+    uint64_t acc = acc_[c];
+    uint64_t sum = (acc + ((uint64_t)freq_[c] * cycles));
+    uint64_t shifts = (((sum + 0x80000) >> 20) - ((acc + 0x80000) >> 20));
+    uint32_t lfsr = lfsr_[c];
+    while (shifts--) {
+      lfsr = (((lfsr << 1) & 0x7fffff) | (((lfsr >> 22) ^ (lfsr >> 17)) & 1));
+    }
+    lfsr_[c] = lfsr;
+    acc_[c] = (sum & 0xffffff);
+  }
+  clock_envelope(c, cycles);
+}
+
+uint16_t SidReadback::rate_period(int c)
+{
+  switch (state_[c]) {
+    case kAttack:       return kRatePeriod[(ad_[c] >> 4)];
+    case kDecaySustain: return kRatePeriod[(ad_[c] & 0x0f)];
+    default:            return kRatePeriod[(sr_[c] & 0x0f)];
+  }
+}
+
+/**
+ * @brief step the envelope over cycles
+ *
+ * Jumps from one rate counter period to the next, and over the
+ * whole span once the envelope can't change anymore. A counter
+ * past a shortened period wraps at 0x8000 like the chip does.
+ */
+void SidReadback::clock_envelope(int c, unsigned int cycles)
+{
+  while (cycles > 0) {
+    uint16_t period = rate_period(c);
+    if (hold_zero_[c]
+        || (state_[c] == kDecaySustain && env_[c] == ((sr_[c] >> 4) * 0x11))) {
+      rate_cnt_[c] = ((rate_cnt_[c] + cycles) % period);
+      return;
+    }
+    unsigned int left = ((rate_cnt_[c] < period)
+      ? (period - rate_cnt_[c])
+      : ((0x8000 - rate_cnt_[c]) + period));
+    if (cycles < left) {
+      rate_cnt_[c] = ((rate_cnt_[c] + cycles) & 0x7fff);
+      return;
+    }
+    cycles -= left;
+    rate_cnt_[c] = 0;
+    if (state_[c] != kAttack) {
+      uint8_t env = env_[c];
+      uint8_t exp_period = ((env > 0x5d) ? 1 : (env > 0x36) ? 2 : (env > 0x1a) ? 4
+        : (env > 0x0e) ? 8 : (env > 0x06) ? 16 : 30);
+      if (++exp_cnt_[c] < exp_period) continue;
+    }
+    exp_cnt_[c] = 0;
+    switch (state_[c]) {
+      case kAttack:
+        if (env_[c] == 0xff || ++env_[c] == 0xff) state_[c] = kDecaySustain;
+        break;
+      case kDecaySustain:
+      case kRelease:
+        env_[c]--;
+        break;
+      default:
+        break;
+    }
+    if (env_[c] == 0) hold_zero_[c] = true;
+  }
+}
+
+/**
+ * @brief upper 8 bits of the voice 3 waveform
+ * Combined waveforms are approximated by and-ing them
+ */
+uint8_t SidReadback::osc3(int c)
+{
+  uint8_t select = (ctrl_[c] >> 4);
+  if (select == 0) return 0;
+  uint32_t acc = acc_[c];
+  uint8_t v = 0xff;
+  if (select & 0x01) { /* triangle */
+    uint32_t t = ((acc & 0x800000) ? (acc ^ 0xffffff) : acc);
+    v &= ((t >> 15) & 0xff);
+  }
+  if (select & 0x02) { /* sawtooth */
+    v &= (acc >> 16);
+  }
+  if (select & 0x04) { /* pulse */
+    v &= (((ctrl_[c] & 0x08) || (acc >> 12) >= pw_[c]) ? 0xff : 0x00);
+  }
+  if (select & 0x08) { /* noise */
+    uint32_t l = lfsr_[c];
+    /* bits 20, 18, 14, 11, 9, 5, 2 and 0, as in SidSynth::step() */
+    v &= ((((l >> 20) & 1) << 7) | (((l >> 18) & 1) << 6)
+        | (((l >> 14) & 1) << 5) | (((l >> 11) & 1) << 4)
+        | (((l >> 9) & 1) << 3) | (((l >> 5) & 1) << 2)
+        | (((l >> 2) & 1) << 1) | (l & 1));
+  }
+  return v;
+}
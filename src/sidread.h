@@ -0,0 +1,90 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidread.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_SIDREAD_H
+#define EMUDORE_SIDREAD_H
+
+#include <cstdint>
+
+
+/**
+ * @brief SID register read-back without the chip
+ *
+ * Answers reads on the emulation side so a tune polling the
+ * SID doesn't wait for a round trip to the hardware.
+ *
+ * - Write-only registers return the last value put on the data
+ *   bus, it fades to 0 like the bus capacitance of the chip does
+ * - OSC3 and ENV3 come from a model of voice 3, clocked lazily
+ *   to the cycle of the access (no sync or ring modulation)
+ * - The paddle registers are not modelled, the caller asks the
+ *   device or reports no paddles
+ */
+class SidReadback
+{
+  public:
+    SidReadback();
+
+    void reset();
+    void model(int chip, bool mos8580);
+    void write(int chip, uint8_t reg, uint8_t v, unsigned int cycle);
+    uint8_t read(int chip, uint8_t reg, unsigned int cycle);
+
+    static constexpr int kMaxChips = 4;
+    static constexpr uint8_t kPotX = 0x19;
+    static constexpr uint8_t kPotY = 0x1a;
+    static constexpr uint8_t kOsc3 = 0x1b;
+    static constexpr uint8_t kEnv3 = 0x1c;
+
+  private:
+    /* data bus */
+    uint8_t bus_[kMaxChips];
+    unsigned int bus_clk_[kMaxChips];
+    unsigned int bus_ttl_[kMaxChips]; /* cycles until the value fades */
+
+    /* voice 3 */
+    unsigned int clk_[kMaxChips];     /* cycle the model is clocked to */
+    uint32_t acc_[kMaxChips];         /* 24 bit phase accumulator */
+    uint32_t lfsr_[kMaxChips];        /* 23 bit noise shift register */
+    uint16_t freq_[kMaxChips];
+    uint16_t pw_[kMaxChips];          /* 12 bit pulse width */
+    uint8_t ctrl_[kMaxChips];
+    uint8_t ad_[kMaxChips];
+    uint8_t sr_[kMaxChips];
+    uint8_t env_[kMaxChips];
+    uint8_t state_[kMaxChips];
+    uint16_t rate_cnt_[kMaxChips];
+    uint8_t exp_cnt_[kMaxChips];
+    bool hold_zero_[kMaxChips];       /* envelope frozen at 0 */
+
+    enum kEnvState
+    {
+      kAttack,
+      kDecaySustain,
+      kRelease,
+    };
+
+    void clock(int c, unsigned int cycle);
+    void clock_envelope(int c, unsigned int cycles);
+    uint16_t rate_period(int c);
+    uint8_t osc3(int c);
+};
+
+#endif /* EMUDORE_SIDREAD_H */
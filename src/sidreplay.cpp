@@ -0,0 +1,201 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidreplay.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * adorable-sidreplay, plays a register stream recorded with
+ * -sidrecord on the USBSID hardware or the built-in synth,
+ * nothing of the machine that produced it is emulated.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <vector>
+
+#include <util.h>
+#include <sidbackend.h>
+#include <sidstream.h>
+#include <sidsynth.h>
+#include <sidserver.h>
+#include <usbsidmock.h>
+
+static const char *kModelNames[4] = {"unknown", "6581", "8580", "6581/8580"};
+
+static void usage()
+{
+  printf("usage: adorable-sidreplay [options] file\n");
+  printf("\n");
+  printf("-info          : print the stream header and length\n");
+  #if USBSID_DRIVER
+  printf("-nohw          : don't use USBSID hardware\n");
+  #endif
+  #if SDL_ENABLED
+  printf("-synth         : play with the built-in synth\n");
+  #endif
+  printf("-wav file      : render with the built-in synth to a WAV file\n");
+  printf("-backend x     : also play on one of %s\n", SidBackend::kNames);
+  printf("-logsid        : log backend statistics on exit\n");
+  printf("-server path   : publish the writes on a Unix socket at path\n");
+  printf("-mocklatency # : usbsidmock USB latency in microseconds\n");
+  printf("-mockjitter #  : usbsidmock random extra latency in microseconds\n");
+  printf("-sidmodel #    : synth chip model 6581 or 8580\n");
+  printf("                 (default: from the stream, else 6581)\n");
+}
+
+/**
+ * @brief walk the stream without playing it
+ */
+static int info(SidStreamReader &in)
+{
+  const SidStream::Header &h = in.header();
+  printf("Clock              : %u Hz\n", h.clock);
+  printf("Chips              : %u\n", h.chips);
+  for(int c = 0 ; c < h.chips && c < SidStream::kMaxChips ; c++)
+  {
+    printf("SID %d              : $%04X %s\n", (c + 1), h.addr[c], kModelNames[h.model[c] & 3]);
+  }
+  SidStream::Record r;
+  uint64_t cycles = 0;
+  unsigned long writes = 0;
+  while (in.next(r)) {
+    cycles += r.cycles;
+    if (r.kind == SidStream::kEnd) break;
+    writes++;
+  }
+  printf("Writes             : %lu\n", writes);
+  printf("Length             : %.2fs\n", (h.clock ? ((double)cycles / h.clock) : 0.0));
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char *file = nullptr;
+  bool show_info = false;
+  bool use_hw = true;
+  const char *extra = nullptr;
+  const char *server = nullptr;
+  for(int a = 1; a < argc; a++) {
+    if(!strcmp(argv[a], "-info")) {show_info = true;}
+    else if(!strcmp(argv[a], "-nohw")) {use_hw = false;}
+    else if(!strcmp(argv[a], "-synth")) {SidSynth::play_audio = true;}
+    else if(!strcmp(argv[a], "-wav") && (a+1) < argc) {SidSynth::wav_file = argv[++a];}
+    else if(!strcmp(argv[a], "-backend") && (a+1) < argc) {extra = argv[++a];}
+    else if(!strcmp(argv[a], "-logsid")) {SidBackend::log_stats = true;}
+    else if(!strcmp(argv[a], "-server") && (a+1) < argc) {server = argv[++a];}
+    else if(!strcmp(argv[a], "-mocklatency") && (a+1) < argc) {
+      UsbsidMock::latency_us = strtoul(argv[++a], NULL, 10);
+    }
+    else if(!strcmp(argv[a], "-mockjitter") && (a+1) < argc) {
+      UsbsidMock::jitter_us = strtoul(argv[++a], NULL, 10);
+    }
+    else if(!strcmp(argv[a], "-sidmodel") && (a+1) < argc) {
+      SidSynth::force_model = (!strcmp(argv[++a], "8580") ? 2 : 1);
+    }
+    else if(!strcmp(argv[a], "-h")) {usage(); return 1;}
+    else {file = argv[a];}
+  }
+  if (file == nullptr) {
+    usage();
+    return 1;
+  }
+
+  SidStreamReader in(file);
+  if (!in.ok()) return 2;
+  if (show_info) return info(in);
+  const SidStream::Header &h = in.header();
+
+  /* pick the backends, hardware first */
+  std::vector<SidBackend *> backends;
+  auto add = [&backends](SidBackend *b) {
+    if (b != nullptr && b->ok()) backends.push_back(b);
+    else delete b;
+  };
+  #if USBSID_DRIVER
+  if (use_hw) add(SidBackend::create("usbsid"));
+  #else
+  (void)use_hw;
+  #endif
+  if (!SidSynth::wav_file.empty() || SidSynth::play_audio) add(SidBackend::create("synth"));
+  if (extra != nullptr) add(SidBackend::create(extra));
+  if (server != nullptr) add(new SidServer(server, h.clock));
+  if (backends.empty()) {
+    fprintf(stderr, "[REPLAY] No SID backend, use -wav or -synth\n");
+    return 2;
+  }
+  uint32_t clock = (h.clock ? h.clock : SidSynth::kClock);
+  bool clocked = false, ticked = false, synth = false;
+  for (SidBackend *b : backends) {
+    for(int c = 0 ; c < h.chips && c < SidStream::kMaxChips ; c++)
+    {
+      b->chip(c, h.addr[c], h.model[c]);
+    }
+    b->resync(0);
+    clocked |= b->clocked();
+    ticked |= b->ticked();
+    synth |= !strcmp(b->name(), "synth");
+  }
+  if (synth && clock != SidSynth::kClock) {
+    fprintf(stderr, "[REPLAY] Stream clock is %u Hz, the synth renders at %u Hz\n",
+      clock, SidSynth::kClock);
+  }
+  /* play in real time unless a backend keeps time itself */
+  SidThrottle *throttle = (clocked ? nullptr : new SidThrottle(clock, SidThrottle::kDefaultSyncMicros));
+  const unsigned int tick = (clock / 50);
+  unsigned int next_tick = tick;
+  unsigned int paced = 0;
+  auto pace = [&](unsigned int to) {
+    if (throttle != nullptr) throttle->throttle(to - paced);
+    paced = to;
+  };
+
+  SidStream::Record r;
+  SidWrite w;
+  unsigned int cycle = 0;
+  unsigned long writes = 0;
+  while (in.next(r)) {
+    cycle += r.cycles;
+    /* frame ticks in between for the backends that want them */
+    while (ticked && (int)(cycle - next_tick) >= 0) {
+      pace(next_tick);
+      for (SidBackend *b : backends) {
+        if (b->ticked()) b->flush(next_tick);
+      }
+      next_tick += tick;
+    }
+    pace(cycle);
+    if (r.kind == SidStream::kEnd) {
+      for (SidBackend *b : backends) b->flush(cycle);
+      break;
+    }
+    w.cycle = cycle;
+    w.kind = SidWrite::kWrite;
+    w.chip = r.chip;
+    w.reg = r.reg;
+    w.value = r.value;
+    for (SidBackend *b : backends) b->submit(&w, 1);
+    writes++;
+  }
+  printf("[REPLAY] %lu writes, %.2fs\n", writes, (h.clock ? ((double)cycle / h.clock) : 0.0));
+
+  for (SidBackend *b : backends) delete b;
+  delete throttle;
+  return 0;
+}
@@ -0,0 +1,308 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidserver.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <util.h>
+#include <sidserver.h>
+
+#if DESKTOP
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 /* SO_NOSIGPIPE is set on the socket instead */
+#endif
+
+
+static void put16(uint8_t *p, uint16_t v)
+{
+  p[0] = (v & 0xff);
+  p[1] = (v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+  for (int i = 0; i < 4; i++) p[i] = ((v >> (i * 8)) & 0xff);
+}
+
+SidServer::SidServer(const std::string &path, uint32_t clock, unsigned int frame_cycles) :
+  path_(path),
+  listen_(-1),
+  clock_(clock),
+  frame_cycles_(frame_cycles),
+  chips_(1),
+  frame_start_(0),
+  records_(0),
+  seq_(0),
+  started_(false),
+  frames_(0),
+  writes_(0),
+  served_(0),
+  dropped_(0)
+{
+  memset(addr_, 0, sizeof(addr_));
+  memset(model_, 0, sizeof(model_));
+  addr_[0] = 0x40; /* $D400 */
+  packet_.reserve(kHeaderSize + (kMaxRecords * kRecordSize));
+
+  struct sockaddr_un sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(sa.sun_path)) {
+    fprintf(stderr, "[SIDSERVER] Socket path %s is too long\n", path.c_str());
+    return;
+  }
+  strncpy(sa.sun_path, path.c_str(), (sizeof(sa.sun_path) - 1));
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    fprintf(stderr, "[SIDSERVER] Unable to create a socket: %s\n", strerror(errno));
+    return;
+  }
+  /* a socket left behind by an earlier run, never anything else */
+  struct stat st;
+  bool taken = false;
+  if (lstat(path.c_str(), &st) == 0) {
+    if (S_ISSOCK(st.st_mode)) unlink(path.c_str());
+    else taken = true;
+  }
+  if (taken) errno = EEXIST;
+  if (taken || bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0
+      || listen(fd, kMaxClients) < 0
+      || fcntl(fd, F_SETFL, (fcntl(fd, F_GETFL) | O_NONBLOCK)) < 0) {
+    fprintf(stderr, "[SIDSERVER] Unable to listen on %s: %s\n", path.c_str(), strerror(errno));
+    close(fd);
+    return;
+  }
+  listen_ = fd;
+  D("[EMU] SidServer listening on %s\n", path.c_str());
+}
+
+SidServer::~SidServer()
+{
+  if (listen_ < 0) return;
+  if (started_) {
+    end(clk_ - frame_start_);
+    publish();
+  }
+  for (int fd : clients_) close(fd);
+  close(listen_);
+  unlink(path_.c_str());
+  if (log_stats) printf("[SIDSERVER] %lu frame packets, %lu writes published, %lu clients served, %lu dropped\n",
+    frames_, writes_, served_, dropped_);
+}
+
+// packets ///////////////////////////////////////////////////////////////////
+
+/**
+ * @brief start a packet, the counts are filled in by end()
+ */
+void SidServer::begin(uint8_t kind, unsigned int cycle)
+{
+  packet_.assign(kHeaderSize, 0);
+  packet_[0] = kind;
+  put32(&packet_[8], cycle);
+  records_ = 0;
+}
+
+void SidServer::end(unsigned int cycles)
+{
+  put16(&packet_[2], records_);
+  put32(&packet_[4], seq_);
+  put32(&packet_[12], (((int)cycles < 0) ? 0 : cycles));
+}
+
+/**
+ * @brief close frames up to cycle
+ *
+ * The frame being collected goes out when cycle is past its
+ * end, the whole frames after it as one empty packet.
+ */
+void SidServer::advance(unsigned int cycle)
+{
+  if (!started_) {
+    started_ = true;
+    frame_start_ = cycle;
+    begin(kFrame, cycle);
+    return;
+  }
+  unsigned int elapsed = (cycle - frame_start_);
+  if ((int)elapsed < (int)frame_cycles_) return;
+  if (records_ != 0) {
+    end(frame_cycles_);
+    publish();
+    frame_start_ += frame_cycles_;
+    elapsed -= frame_cycles_;
+    begin(kFrame, frame_start_);
+  }
+  if (elapsed >= frame_cycles_) {
+    unsigned int span = ((elapsed / frame_cycles_) * frame_cycles_);
+    end(span);
+    publish();
+    frame_start_ += span;
+    begin(kFrame, frame_start_);
+  }
+}
+
+/**
+ * @brief send the packet to every client
+ * New clients get the chip layout first
+ */
+void SidServer::publish()
+{
+  accept_clients();
+  for (size_t i = 0; i < clients_.size();) {
+    if (send_to(clients_[i], packet_.data(), packet_.size())) {
+      i++;
+      continue;
+    }
+    close(clients_[i]);
+    clients_.erase(clients_.begin() + i);
+    dropped_++;
+  }
+  if (packet_[0] == kFrame) frames_++;
+  seq_++;
+}
+
+/**
+ * @brief all of the packet or the client goes
+ * A short send leaves the client's stream out of step
+ */
+bool SidServer::send_to(int fd, const uint8_t *data, size_t size)
+{
+  ssize_t n = send(fd, data, size, (MSG_DONTWAIT | MSG_NOSIGNAL));
+  return (n == (ssize_t)size);
+}
+
+void SidServer::accept_clients()
+{
+  int fd;
+  while ((fd = accept(listen_, nullptr, nullptr)) >= 0) {
+    if (clients_.size() >= kMaxClients) {
+      close(fd);
+      continue;
+    }
+    #if defined(SO_NOSIGPIPE)
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+    #endif
+    fcntl(fd, F_SETFL, (fcntl(fd, F_GETFL) | O_NONBLOCK));
+    hello(fd);
+  }
+}
+
+void SidServer::hello(int fd)
+{
+  uint8_t p[kHeaderSize + (kMaxChips * kRecordSize)];
+  memset(p, 0, sizeof(p));
+  p[0] = kHello;
+  put16(&p[2], chips_);
+  put32(&p[4], seq_);
+  put32(&p[8], frame_start_);
+  put32(&p[12], clock_);
+  for (int c = 0; c < chips_; c++) {
+    uint8_t *r = &p[kHeaderSize + (c * kRecordSize)];
+    r[4] = c;
+    r[5] = addr_[c];
+    r[6] = model_[c];
+  }
+  if (!send_to(fd, p, (kHeaderSize + (chips_ * kRecordSize)))) {
+    close(fd);
+    dropped_++;
+    return;
+  }
+  clients_.push_back(fd);
+  served_++;
+}
+
+// backend ///////////////////////////////////////////////////////////////////
+
+void SidServer::submit(const SidWrite *w, size_t n)
+{
+  for (size_t i = 0; i < n; i++) {
+    advance(w[i].cycle);
+    if (records_ == kMaxRecords) {
+      /* the rest of the frame follows with the same span */
+      end(frame_cycles_);
+      publish();
+      begin(kFrame, frame_start_);
+    }
+    uint8_t r[kRecordSize];
+    put32(r, w[i].cycle);
+    r[4] = w[i].chip;
+    r[5] = w[i].reg;
+    r[6] = w[i].value;
+    r[7] = 0;
+    packet_.insert(packet_.end(), r, (r + kRecordSize));
+    records_++;
+  }
+  writes_ += n;
+  if (n != 0) clk_ = w[n - 1].cycle;
+}
+
+void SidServer::flush(unsigned int cycle)
+{
+  advance(cycle);
+  clk_ = cycle;
+}
+
+/**
+ * @brief a cpu clock that went back restarts the frames
+ */
+void SidServer::resync(unsigned int cycle)
+{
+  if (started_ && (int)(cycle - frame_start_) < 0) {
+    end(clk_ - frame_start_);
+    publish();
+    started_ = false;
+  }
+  flush(cycle);
+}
+
+void SidServer::reset(unsigned int cycle)
+{
+  if (started_) {
+    end(cycle - frame_start_);
+    publish();
+  }
+  begin(kReset, cycle);
+  end(0);
+  publish();
+  started_ = false;
+  flush(cycle);
+}
+
+/**
+ * @brief chip layout, clients connected later get it on hello
+ * @param type PSID chip type
+ */
+void SidServer::chip(uint8_t chip, uint16_t addr, uint8_t type)
+{
+  if (chip >= kMaxChips) return;
+  addr_[chip] = ((addr >> 4) & 0xff);
+  model_[chip] = type;
+  if (chip >= chips_) chips_ = (chip + 1);
+}
+
+#endif /* DESKTOP */
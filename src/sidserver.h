@@ -0,0 +1,123 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidserver.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_SIDSERVER_H
+#define EMUDORE_SIDSERVER_H
+
+#if DESKTOP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sidbackend.h>
+
+
+/**
+ * @brief publishes the register stream on a Unix domain socket
+ *
+ * Any number of clients (up to kMaxClients) connect to the
+ * socket to subscribe. Writes are collected for one frame and
+ * the frame goes out as one packet, built once and sent to
+ * every client with one non-blocking send. A client that can't
+ * take a whole packet is dropped, the transport never waits
+ * for a reader.
+ *
+ * Packets, all values little endian:
+ *
+ *  header  u8 kind, u8 reserved, u16 number of records,
+ *          u32 sequence number, u32 first cycle, u32 cycles
+ *  record  u32 cycle, u8 chip, u8 register, u8 value, u8 0
+ *
+ *  kHello  first packet on connect, the cycles are the clock
+ *          in Hz, one record per chip with the PSID address
+ *          byte as register and the PSID chip model as value
+ *  kFrame  the writes from first cycle up to first + cycles,
+ *          sent for every frame, with or without writes
+ *  kReset  the machine was reset at first cycle
+ *
+ * A frame with more than kMaxRecords writes goes out in parts
+ * that all carry the frame's first cycle and cycles. Whole
+ * frames without writes go out as one packet.
+ */
+class SidServer : public SidBackend
+{
+  public:
+    SidServer(const std::string &path, uint32_t clock,
+      unsigned int frame_cycles = kFrameCycles);
+    ~SidServer();
+
+    const char *name() {return "server";};
+    bool ok() {return (listen_ >= 0);};
+    bool ticked() {return true;}; /* frames go out on time */
+    void submit(const SidWrite *w, size_t n);
+    void flush(unsigned int cycle);
+    void resync(unsigned int cycle);
+    void reset(unsigned int cycle);
+    void chip(uint8_t chip, uint16_t addr, uint8_t type);
+
+    enum kKind
+    {
+      kHello = 1,
+      kFrame = 2,
+      kReset = 3,
+    };
+    static constexpr unsigned int kFrameCycles = 19656; /* PAL */
+    static constexpr size_t kHeaderSize = 16;
+    static constexpr size_t kRecordSize = 8;
+    static constexpr size_t kMaxRecords = 4096;
+    static constexpr size_t kMaxClients = 8;
+    static constexpr int kMaxChips = 4;
+
+  private:
+    std::string path_;
+    int listen_;
+    std::vector<int> clients_;
+    uint32_t clock_;
+    unsigned int frame_cycles_;
+    uint8_t chips_;
+    uint8_t addr_[kMaxChips];
+    uint8_t model_[kMaxChips];
+
+    /* frame being collected */
+    std::vector<uint8_t> packet_;
+    unsigned int frame_start_;
+    uint16_t records_;
+    uint32_t seq_;
+    bool started_;
+
+    /* statistics */
+    unsigned long frames_;
+    unsigned long writes_;
+    unsigned long served_;
+    unsigned long dropped_;
+
+    void advance(unsigned int cycle);
+    void begin(uint8_t kind, unsigned int cycle);
+    void end(unsigned int cycles);
+    void accept_clients();
+    void hello(int fd);
+    bool send_to(int fd, const uint8_t *data, size_t size);
+    void publish();
+};
+
+#endif /* DESKTOP */
+
+#endif /* EMUDORE_SIDSERVER_H */
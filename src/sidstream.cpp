@@ -0,0 +1,210 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidstream.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <util.h>
+#include <sidstream.h>
+
+#if DESKTOP
+
+#include <algorithm>
+#include <cstring>
+
+
+static const char kMagic[8] = {'S','I','D','S','T','R','M','1'};
+
+// writer ////////////////////////////////////////////////////////////////////
+
+SidStreamWriter::SidStreamWriter(const std::string &path, uint32_t clock) :
+  path_(path),
+  chips_seen_(1),
+  started_(false),
+  last_cycle_(0),
+  end_cycle_(0),
+  writes_(0),
+  bytes_(0)
+{
+  memset(&header_, 0, sizeof(header_));
+  header_.clock = clock;
+  header_.chips = 1;
+  header_.addr[0] = 0xd400;
+  out_ = fopen(path.c_str(), "wb");
+  if (out_ == nullptr) {
+    fprintf(stderr, "[SIDSTREAM] Unable to open %s for writing\n", path.c_str());
+    return;
+  }
+  write_header(); /* rewritten on close */
+  D("[EMU] SidStreamWriter initialized.\n");
+}
+
+SidStreamWriter::~SidStreamWriter()
+{
+  if (out_ == nullptr) return;
+  /* keep the time after the last write */
+  record(delta(end_cycle_), SidStream::kEnd);
+  fseek(out_, 0, SEEK_SET);
+  write_header();
+  fclose(out_);
+  printf("[SIDSTREAM] %lu writes, %lu bytes written to %s\n",
+    writes_, (bytes_ + SidStream::kHeaderSize), path_.c_str());
+}
+
+/**
+ * @brief chip layout for the header, taken from the PSID header
+ */
+void SidStreamWriter::describe(uint8_t chip, uint16_t addr, uint8_t model)
+{
+  if (chip >= SidStream::kMaxChips) return;
+  header_.addr[chip] = addr;
+  header_.model[chip] = model;
+  if (chip >= header_.chips) header_.chips = (chip + 1);
+}
+
+void SidStreamWriter::write_header()
+{
+  uint8_t h[SidStream::kHeaderSize];
+  size_t i = 0;
+  memcpy(h, kMagic, 8);
+  i += 8;
+  for(int b = 0 ; b < 4 ; b++) h[i++] = ((header_.clock >> (b * 8)) & 0xff);
+  h[i++] = std::max(header_.chips, chips_seen_);
+  for(int c = 0 ; c < SidStream::kMaxChips ; c++)
+  {
+    h[i++] = (header_.addr[c] & 0xff);
+    h[i++] = (header_.addr[c] >> 8);
+    h[i++] = header_.model[c];
+  }
+  fwrite(h, 1, i, out_);
+}
+
+uint32_t SidStreamWriter::delta(unsigned int cycle)
+{
+  if (!started_) {
+    started_ = true;
+    last_cycle_ = end_cycle_ = cycle;
+    return 0;
+  }
+  unsigned int cycles = (cycle - last_cycle_);
+  if ((int)cycles < 0) cycles = 0; /* cpu clock was reset */
+  last_cycle_ = cycle;
+  return cycles;
+}
+
+void SidStreamWriter::record(uint32_t cycles, uint8_t tag)
+{
+  while (cycles >= 0x80) {
+    putc(((cycles & 0x7f) | 0x80), out_);
+    cycles >>= 7;
+    bytes_++;
+  }
+  putc(cycles, out_);
+  putc(tag, out_);
+  bytes_ += 2;
+}
+
+void SidStreamWriter::write(unsigned int cycle, uint8_t chip, uint8_t reg, uint8_t value)
+{
+  if (out_ == nullptr || chip >= SidStream::kMaxChips) return;
+  record(delta(cycle), ((chip << 5) | (reg & 0x1f)));
+  putc(value, out_);
+  bytes_++;
+  writes_++;
+  end_cycle_ = cycle;
+  if (chip >= chips_seen_) chips_seen_ = (chip + 1);
+  /* not in the PSID header, the default memory map decodes it */
+  if (header_.addr[chip] == 0) header_.addr[chip] = (0xd400 + (chip * 0x20));
+}
+
+/**
+ * @brief time passed without a write
+ * Only the latest is kept, it ends up in the end record
+ */
+void SidStreamWriter::delay(unsigned int cycle)
+{
+  if (out_ == nullptr) return;
+  if (!started_) delta(cycle);
+  if ((int)(cycle - end_cycle_) > 0) end_cycle_ = cycle;
+}
+
+// reader ////////////////////////////////////////////////////////////////////
+
+SidStreamReader::SidStreamReader(const std::string &path)
+{
+  memset(&header_, 0, sizeof(header_));
+  in_ = fopen(path.c_str(), "rb");
+  if (in_ == nullptr) {
+    fprintf(stderr, "[SIDSTREAM] Unable to open %s\n", path.c_str());
+    return;
+  }
+  uint8_t h[SidStream::kHeaderSize];
+  if (fread(h, 1, sizeof(h), in_) != sizeof(h) || memcmp(h, kMagic, 8) != 0) {
+    fprintf(stderr, "[SIDSTREAM] %s is not a SID register stream\n", path.c_str());
+    fclose(in_);
+    in_ = nullptr;
+    return;
+  }
+  size_t i = 8;
+  for(int b = 0 ; b < 4 ; b++) header_.clock |= ((uint32_t)h[i++] << (b * 8));
+  header_.chips = h[i++];
+  for(int c = 0 ; c < SidStream::kMaxChips ; c++)
+  {
+    header_.addr[c] = (h[i] | (h[i + 1] << 8));
+    header_.model[c] = h[i + 2];
+    i += 3;
+  }
+}
+
+SidStreamReader::~SidStreamReader()
+{
+  if (in_ != nullptr) fclose(in_);
+}
+
+/**
+ * @brief read the next record
+ * @return false at the end of the stream
+ */
+bool SidStreamReader::next(SidStream::Record &r)
+{
+  if (in_ == nullptr) return false;
+  int c;
+  uint32_t cycles = 0;
+  int shift = 0;
+  do {
+    if ((c = getc(in_)) == EOF || shift > 28) return false;
+    cycles |= ((uint32_t)(c & 0x7f) << shift);
+    shift += 7;
+  } while (c & 0x80);
+  int tag = getc(in_);
+  if (tag == EOF) return false;
+  r.cycles = cycles;
+  r.chip = r.reg = r.value = 0;
+  if (tag == SidStream::kEnd) {
+    r.kind = tag;
+    return true;
+  }
+  int value = getc(in_);
+  if (value == EOF) return false;
+  r.kind = SidStream::kWrite;
+  r.chip = ((tag >> 5) & 0x03);
+  r.reg = (tag & 0x1f);
+  r.value = value;
+  return true;
+}
+
+#endif /* DESKTOP */
@@ -0,0 +1,128 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidstream.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_SIDSTREAM_H
+#define EMUDORE_SIDSTREAM_H
+
+#if DESKTOP
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+
+
+/**
+ * @brief SID register stream file
+ *
+ * Every register write with the cycles since the previous one,
+ * enough to replay a tune on any SID backend without emulating
+ * the machine that produced it.
+ *
+ * Layout, all values little endian:
+ *
+ *  header  "SIDSTRM1", u32 clock in Hz, u8 number of chips,
+ *          per chip slot (kMaxChips) u16 address and u8 PSID
+ *          chip model (0 unknown, 1 6581, 2 8580, 3 both)
+ *  write   varint cycles, u8 (chip << 5) | register, u8 value
+ *  end     varint cycles to the last cycle seen, u8 kEnd
+ *
+ * The varint is 7 bits per byte, least significant first, bit 7
+ * set when more bytes follow. Most writes take 3 or 4 bytes.
+ */
+struct SidStream
+{
+  static constexpr int kMaxChips = 4;
+  static constexpr uint8_t kWrite = 0x00;
+  static constexpr uint8_t kEnd = 0xff;
+  static constexpr size_t kHeaderSize = (8 + 4 + 1 + (kMaxChips * 3));
+
+  struct Header
+  {
+    uint32_t clock;
+    uint8_t chips;
+    uint16_t addr[kMaxChips];
+    uint8_t model[kMaxChips];
+  };
+
+  struct Record
+  {
+    uint32_t cycles; /* since the previous record */
+    uint8_t kind;    /* kWrite or kEnd */
+    uint8_t chip;
+    uint8_t reg;
+    uint8_t value;
+  };
+};
+
+/**
+ * @brief records a register stream
+ *
+ * The header is written with the defaults on open and rewritten
+ * with the final chip layout on close.
+ */
+class SidStreamWriter
+{
+  public:
+    SidStreamWriter(const std::string &path, uint32_t clock);
+    ~SidStreamWriter();
+
+    bool ok(){return out_ != nullptr;};
+    void describe(uint8_t chip, uint16_t addr, uint8_t model);
+    void write(unsigned int cycle, uint8_t chip, uint8_t reg, uint8_t value);
+    void delay(unsigned int cycle);
+    unsigned long writes(){return writes_;};
+
+  private:
+    FILE *out_;
+    std::string path_;
+    SidStream::Header header_;
+    uint8_t chips_seen_;
+    bool started_;
+    unsigned int last_cycle_;  /* cycle of the last record */
+    unsigned int end_cycle_;   /* latest cycle seen */
+    unsigned long writes_;
+    unsigned long bytes_;
+
+    uint32_t delta(unsigned int cycle);
+    void record(uint32_t cycles, uint8_t tag);
+    void write_header();
+};
+
+/**
+ * @brief reads a register stream back
+ */
+class SidStreamReader
+{
+  public:
+    SidStreamReader(const std::string &path);
+    ~SidStreamReader();
+
+    bool ok(){return in_ != nullptr;};
+    const SidStream::Header &header(){return header_;};
+    bool next(SidStream::Record &r);
+
+  private:
+    FILE *in_;
+    SidStream::Header header_;
+};
+
+#endif /* DESKTOP */
+
+#endif /* EMUDORE_SIDSTREAM_H */
@@ -0,0 +1,433 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidsynth.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <util.h>
+#include <sidsynth.h>
+
+#if DESKTOP
+
+#include <cmath>
+#include <cstring>
+#include <chrono>
+#include <thread>
+
+
+std::string SidSynth::wav_file = "";
+bool SidSynth::play_audio = false;
+unsigned int SidSynth::seconds = 0;
+int SidSynth::force_model = -1;
+
+/* envelope counter period per rate nibble, in cycles */
+static const uint32_t kRatePeriod[16] = {
+  9, 32, 63, 95, 149, 220, 267, 313,
+  392, 977, 1954, 3126, 3907, 11720, 19532, 31251,
+};
+
+/* 6581 cutoff in Hz at every 128 steps of the 11 bit register, approximated */
+static const float k6581Cutoff[17] = {
+  220, 230, 250, 300, 420, 780, 1600, 2300, 3000,
+  3600, 4300, 5000, 5800, 6400, 7000, 7600, 8200,
+};
+
+static const float kVoiceMax = (2048.0f * 255.0f); /* waveform * envelope */
+static const float kStepRate = ((float)SidSynth::kClock / SidSynth::kStep);
+static const uint32_t kNoiseSeed = 0x7ffff8;
+/* SDL audio kept queued, about 100ms */
+static const uint32_t kMaxQueued = ((SidSynth::kRate / 10) * sizeof(int16_t));
+
+// ctor and dtor /////////////////////////////////////////////////////////////
+
+SidSynth::SidSynth() :
+  fill_(0),
+  wav_(nullptr),
+  samples_(0),
+  audio_on_(false)
+{
+  for(int c = 0 ; c < kMaxChips ; c++) model_[c] = k6581;
+  reset();
+  if (!wav_file.empty()) {
+    wav_ = fopen(wav_file.c_str(), "wb");
+    if (wav_ == nullptr) {
+      fprintf(stderr, "[SYNTH] Unable to open %s for writing\n", wav_file.c_str());
+    } else {
+      wav_header(0); /* sizes are filled in on close */
+    }
+  }
+  #if SDL_ENABLED
+  if (play_audio) {
+    SDL_InitSubSystem(SDL_INIT_AUDIO);
+    SDL_AudioSpec want, have;
+    memset(&want, 0, sizeof(want));
+    want.freq = kRate;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = 1024;
+    want.callback = NULL; /* queued */
+    audio_ = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (audio_ == 0) {
+      fprintf(stderr, "[SYNTH] Unable to open audio device: %s\n", SDL_GetError());
+    } else {
+      SDL_PauseAudioDevice(audio_, 0);
+      audio_on_ = true;
+    }
+  }
+  #endif
+  D("[EMU] SidSynth initialized.\n");
+}
+
+SidSynth::~SidSynth()
+{
+  flush_out();
+  if (wav_ != nullptr) {
+    fseek(wav_, 0, SEEK_SET);
+    wav_header(samples_ * sizeof(int16_t));
+    fclose(wav_);
+    printf("[SYNTH] %lu samples (%.1fs) written to %s\n",
+      samples_, ((double)samples_ / kRate), wav_file.c_str());
+  }
+  #if SDL_ENABLED
+  if (audio_on_) {
+    /* let the queued audio play out */
+    while (SDL_GetQueuedAudioSize(audio_) > 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    SDL_CloseAudioDevice(audio_);
+  }
+  #endif
+}
+
+void SidSynth::reset()
+{
+  memset(regs_, 0, sizeof(regs_));
+  for(int l = 0 ; l < kLanes ; l++)
+  {
+    int chip = (l / 3), voice = (l % 3);
+    acc_[l] = freq_[l] = pw_[l] = ctrl_[l] = 0;
+    hold_[l] = 0xffffffff;
+    rise_[l] = nclk_[l] = 0;
+    lfsr_[l] = kNoiseSeed;
+    noise_[l] = 0;
+    src_[l] = ((chip * 3) + ((voice + 2) % 3)); /* voice 1 <- 3, 2 <- 1, 3 <- 2 */
+    out_[l] = 0;
+    env_[l] = 0;
+    state_[l] = kRelease;
+    memset(adsr_[l], 0, sizeof(adsr_[l]));
+    rate_cnt_[l] = exp_cnt_[l] = 0;
+  }
+  for(int c = 0 ; c < kMaxChips ; c++)
+  {
+    lp_[c] = bp_[c] = 0;
+    update_chip(c);
+  }
+  chips_ = 1;
+  started_ = false;
+  clk_ = rest_ = phase_ = 0;
+  sum_ = 0;
+  sum_n_ = 0;
+  dc_x_ = dc_y_ = 0;
+}
+
+void SidSynth::model(int chip, kModel m)
+{
+  if (chip < 0 || chip >= kMaxChips) return;
+  model_[chip] = m;
+  update_chip(chip);
+}
+
+// registers /////////////////////////////////////////////////////////////////
+
+void SidSynth::write(int chip, uint8_t reg, uint8_t v)
+{
+  if (chip < 0 || chip >= kMaxChips) return;
+  if (chip >= chips_) chips_ = (chip + 1);
+  reg &= 0x1f;
+  regs_[chip][reg] = v;
+  if (reg >= 0x15) {
+    update_chip(chip);
+    return;
+  }
+  int l = ((chip * 3) + (reg / 7));
+  uint8_t *r = &regs_[chip][(reg / 7) * 7];
+  switch (reg % 7) {
+    case 0:
+    case 1:
+      freq_[l] = (r[0] | (r[1] << 8));
+      break;
+    case 2:
+    case 3:
+      pw_[l] = (r[2] | ((r[3] & 0x0f) << 8));
+      break;
+    case 4:
+      {
+        uint8_t prev = ctrl_[l];
+        if ((v & 0x01) && !(prev & 0x01)) state_[l] = kAttack;
+        if (!(v & 0x01) && (prev & 0x01)) state_[l] = kRelease;
+        if (v & 0x08) {
+          /* test holds the accumulator and resets the noise */
+          acc_[l] = 0;
+          lfsr_[l] = kNoiseSeed;
+        }
+        hold_[l] = ((v & 0x08) ? 0 : 0xffffffff);
+        ctrl_[l] = v;
+      }
+      break;
+    case 5:
+      adsr_[l][0] = (v >> 4);
+      adsr_[l][1] = (v & 0x0f);
+      break;
+    case 6:
+      adsr_[l][2] = (v >> 4);
+      adsr_[l][3] = (v & 0x0f);
+      break;
+  }
+}
+
+/**
+ * @brief recalculate filter, routing and volume of a chip
+ */
+void SidSynth::update_chip(int c)
+{
+  const uint8_t *r = regs_[c];
+  unsigned int fc = ((r[0x16] << 3) | (r[0x15] & 0x07));
+  float hz;
+  if (model_[c] == k6581) {
+    unsigned int i = (fc >> 7);
+    float t = ((fc & 0x7f) / 128.0f);
+    hz = (k6581Cutoff[i] + ((k6581Cutoff[i + 1] - k6581Cutoff[i]) * t));
+  } else {
+    hz = (30.0f + (fc * 5.8f)); /* 8580 is close to linear */
+  }
+  w_[c] = (2.0f * sinf(M_PI * hz / kStepRate));
+  float res = ((r[0x17] >> 4) / 15.0f);
+  /* the 6581 resonates less */
+  damp_[c] = ((model_[c] == k6581) ? (1.4f - res) : (1.4f - (res * 1.25f)));
+  lpm_[c] = ((r[0x18] & 0x10) ? 1.0f : 0.0f);
+  bpm_[c] = ((r[0x18] & 0x20) ? 1.0f : 0.0f);
+  hpm_[c] = ((r[0x18] & 0x40) ? 1.0f : 0.0f);
+  vol_[c] = ((r[0x18] & 0x0f) / 15.0f);
+  bias_[c] = ((model_[c] == k6581) ? kVoiceMax : (kVoiceMax * 0.1f));
+  for(int v = 0 ; v < 3 ; v++)
+  {
+    int l = ((c * 3) + v);
+    bool filt = ((r[0x17] >> v) & 1);
+    bool off = ((v == 2) && (r[0x18] & 0x80)); /* 3OFF */
+    route_[l] = (filt ? 1.0f : 0.0f);
+    pass_[l] = ((filt || off) ? 0.0f : 1.0f);
+  }
+}
+
+// synthesis /////////////////////////////////////////////////////////////////
+
+static inline uint32_t exp_period(uint32_t env)
+{
+  if (env > 93) return 1;
+  if (env > 54) return 2;
+  if (env > 26) return 4;
+  if (env > 14) return 8;
+  if (env > 6) return 16;
+  return 30;
+}
+
+void SidSynth::envelope(int l)
+{
+  uint8_t n = ((state_[l] == kAttack) ? adsr_[l][0]
+    : (state_[l] == kDecaySustain) ? adsr_[l][1] : adsr_[l][3]);
+  uint32_t period = kRatePeriod[n];
+  rate_cnt_[l] += kStep;
+  while (rate_cnt_[l] >= period) {
+    rate_cnt_[l] -= period;
+    if (state_[l] == kAttack) {
+      if (env_[l] == 0xff || ++env_[l] == 0xff) state_[l] = kDecaySustain;
+      continue;
+    }
+    if (++exp_cnt_[l] < exp_period(env_[l])) continue;
+    exp_cnt_[l] = 0;
+    uint32_t sustain = ((adsr_[l][2] << 4) | adsr_[l][2]);
+    if (env_[l] == 0) continue;
+    if (state_[l] == kRelease || env_[l] != sustain) env_[l]--;
+  }
+}
+
+/**
+ * @brief advance all chips by kStep cycles
+ */
+void SidSynth::step()
+{
+  const int lanes = (chips_ * 3);
+
+  /**
+   * oscillators and waveforms run over all lanes, unused lanes
+   * are silent and a fixed count keeps the loops vectorized,
+   * at most one msb rise per step as kStep * 0xffff < 2^23
+   */
+  for(int l = 0 ; l < kLanes ; l++)
+  {
+    uint32_t prev = acc_[l];
+    uint32_t next = (prev + ((freq_[l] * kStep) & hold_[l]));
+    /* rising edges of bit 19 clock the noise */
+    nclk_[l] = (((next + 0x80000) >> 20) - ((prev + 0x80000) >> 20));
+    next &= 0xffffff;
+    rise_[l] = (((~prev & next) >> 23) & 1);
+    acc_[l] = next;
+  }
+  /* hard sync, then pick up the ring modulation source */
+  for(int l = 0 ; l < lanes ; l++)
+  {
+    uint32_t sync = (((ctrl_[l] >> 1) & 1) & rise_[src_[l]]);
+    acc_[l] &= (sync - 1);
+  }
+  for(int l = 0 ; l < kLanes ; l++) ring_[l] = acc_[src_[l]];
+  /* noise */
+  for(int l = 0 ; l < lanes ; l++)
+  {
+    if (nclk_[l] == 0) continue;
+    uint32_t r = lfsr_[l];
+    for(uint32_t n = 0 ; n < nclk_[l] ; n++)
+    {
+      r = (((r << 1) | (((r >> 22) ^ (r >> 17)) & 1)) & 0x7fffff);
+    }
+    lfsr_[l] = r;
+    noise_[l] = ((((r >> 20) & 1) << 11) | (((r >> 18) & 1) << 10)
+      | (((r >> 14) & 1) << 9) | (((r >> 11) & 1) << 8)
+      | (((r >> 9) & 1) << 7) | (((r >> 5) & 1) << 6)
+      | (((r >> 2) & 1) << 5) | ((r & 1) << 4));
+  }
+  for(int l = 0 ; l < lanes ; l++) envelope(l);
+  /* waveforms, combined waveforms are the AND of the selected ones */
+  for(int l = 0 ; l < kLanes ; l++)
+  {
+    uint32_t a = acc_[l];
+    uint32_t c = ctrl_[l];
+    uint32_t ring = ((0 - ((c >> 2) & 1)) & ring_[l]);
+    uint32_t fold = (0 - (((a ^ ring) >> 23) & 1));
+    uint32_t tri = (((a ^ fold) >> 11) & 0xfff);
+    uint32_t saw = (a >> 12);
+    uint32_t pulse = ((0 - (uint32_t)((a >> 12) >= pw_[l])) & 0xfff);
+    uint32_t wave = ((tri | (((c >> 4) & 1) - 1))
+      & (saw | (((c >> 5) & 1) - 1))
+      & (pulse | (((c >> 6) & 1) - 1))
+      & (noise_[l] | (((c >> 7) & 1) - 1))
+      & (0 - (uint32_t)((c & 0xf0) != 0)) & 0xfff);
+    out_[l] = ((float)((int)wave - 0x800) * env_[l]);
+  }
+  /* mixer */
+  for(int c = 0 ; c < chips_ ; c++)
+  {
+    const int l = (c * 3);
+    filt_in_[c] = ((out_[l] * route_[l]) + (out_[l + 1] * route_[l + 1]) + (out_[l + 2] * route_[l + 2]));
+    direct_[c] = ((out_[l] * pass_[l]) + (out_[l + 1] * pass_[l + 1]) + (out_[l + 2] * pass_[l + 2]));
+  }
+  /* state variable filters */
+  float mix = 0;
+  for(int c = 0 ; c < chips_ ; c++)
+  {
+    float hp = (filt_in_[c] - lp_[c] - (damp_[c] * bp_[c]));
+    bp_[c] += (w_[c] * hp);
+    lp_[c] += (w_[c] * bp_[c]);
+    float f = ((lp_[c] * lpm_[c]) + (bp_[c] * bpm_[c]) + (hp * hpm_[c]));
+    mix += ((direct_[c] + f + bias_[c]) * vol_[c]);
+  }
+  /* average the steps that make up one output sample */
+  sum_ += mix;
+  sum_n_++;
+  phase_ += (kRate * kStep);
+  if (phase_ >= kClock) {
+    phase_ -= kClock;
+    emit(sum_ / (sum_n_ * 3.0f * kVoiceMax * chips_));
+    sum_ = 0;
+    sum_n_ = 0;
+  }
+}
+
+/**
+ * @brief render up to a cpu cycle
+ */
+void SidSynth::clock_to(unsigned int cycle)
+{
+  unsigned int cycles = (cycle - clk_);
+  clk_ = cycle;
+  if (!started_) {
+    started_ = true;
+    return;
+  }
+  if ((int)cycles <= 0) return; /* cpu clock was reset */
+  cycles += rest_;
+  rest_ = (cycles % kStep);
+  for(unsigned int s = (cycles / kStep) ; s > 0 ; s--) step();
+}
+
+// output ////////////////////////////////////////////////////////////////////
+
+void SidSynth::emit(float v)
+{
+  /* remove the mixer DC, corner around 10Hz */
+  dc_y_ = (v - dc_x_ + (0.9985f * dc_y_));
+  dc_x_ = v;
+  float s = (dc_y_ * 30000.0f);
+  if (s > 32767.0f) s = 32767.0f;
+  if (s < -32768.0f) s = -32768.0f;
+  buf_[fill_++] = (int16_t)s;
+  if (fill_ == kBufSize) flush_out();
+}
+
+void SidSynth::flush_out()
+{
+  if (fill_ == 0) return;
+  if (wav_ != nullptr) fwrite(buf_, sizeof(int16_t), fill_, wav_);
+  #if SDL_ENABLED
+  if (audio_on_) {
+    /* without video pacing the full queue holds back the emulation */
+    while (SDL_GetQueuedAudioSize(audio_) > kMaxQueued)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    SDL_QueueAudio(audio_, buf_, (fill_ * sizeof(int16_t)));
+  }
+  #endif
+  samples_ += fill_;
+  fill_ = 0;
+}
+
+/**
+ * @brief 44 byte PCM header, 16 bit mono little endian
+ */
+void SidSynth::wav_header(uint32_t data_size)
+{
+  uint8_t h[44];
+  auto put32 = [&h](int o, uint32_t v) {
+    for(int b = 0 ; b < 4 ; b++) h[o + b] = ((v >> (b * 8)) & 0xff);
+  };
+  auto put16 = [&h](int o, uint16_t v) {
+    h[o] = (v & 0xff);
+    h[o + 1] = (v >> 8);
+  };
+  memcpy(&h[0], "RIFF", 4);
+  put32(4, (36 + data_size));
+  memcpy(&h[8], "WAVEfmt ", 8);
+  put32(16, 16);
+  put16(20, 1); /* PCM */
+  put16(22, 1);
+  put32(24, kRate);
+  put32(28, (kRate * sizeof(int16_t)));
+  put16(32, sizeof(int16_t));
+  put16(34, 16);
+  memcpy(&h[36], "data", 4);
+  put32(40, data_size);
+  fwrite(h, 1, sizeof(h), wav_);
+}
+
+#endif /* DESKTOP */
@@ -0,0 +1,162 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * sidsynth.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_SIDSYNTH_H
+#define EMUDORE_SIDSYNTH_H
+
+#if DESKTOP
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+
+#if SDL_ENABLED
+#include <SDL.h>
+#endif
+
+
+/**
+ * @brief Software 6581/8580 synthesis
+ *
+ * Renders the SID register stream when there is no hardware,
+ * driven by the transport thread with the cycle stamps of the
+ * recorded accesses, so output follows the emulated clock and
+ * not the wall clock.
+ *
+ * Voice state is kept per lane (chip * 3 + voice) in plain
+ * arrays, oscillators, waveforms and the per chip filters run
+ * as loops over all lanes of all chips which the compiler
+ * turns into vector code. Envelopes and noise are stepped per
+ * lane.
+ *
+ * The chip is clocked in steps of kStep cycles and averaged
+ * down to kRate, the filter is a state variable filter with an
+ * approximated 6581 or linear 8580 cutoff curve.
+ *
+ * Output is 16 bit mono to a WAV file and/or SDL audio.
+ */
+class SidSynth
+{
+  public:
+    enum kModel
+    {
+      k6581,
+      k8580,
+    };
+
+    SidSynth();
+    ~SidSynth();
+
+    bool ok(){return (wav_ != nullptr || audio_on_);};
+    void reset();
+    void model(int chip, kModel m);
+    void write(int chip, uint8_t reg, uint8_t v);
+    void clock_to(unsigned int cycle);
+
+    /* configured from the command line */
+    static std::string wav_file;
+    static bool play_audio;
+    static unsigned int seconds; /* stop after, 0 = no limit */
+    static int force_model;      /* -1 = from the tune */
+
+    static constexpr int kMaxChips = 4;
+    static constexpr int kLanes = (kMaxChips * 3);
+    static constexpr unsigned int kClock = 985248; /* PAL phi2 */
+    static constexpr unsigned int kRate = 44100;
+    static constexpr unsigned int kStep = 8; /* cycles per synthesis step */
+
+  private:
+    /* voice lanes, index = chip * 3 + voice */
+    uint32_t acc_[kLanes];    /* 24 bit phase accumulator */
+    uint32_t freq_[kLanes];
+    uint32_t pw_[kLanes];     /* 12 bit pulse width */
+    uint32_t ctrl_[kLanes];
+    uint32_t hold_[kLanes];   /* 0 while the test bit is set */
+    uint32_t rise_[kLanes];   /* accumulator msb went up this step */
+    uint32_t nclk_[kLanes];   /* noise clocks this step */
+    uint32_t lfsr_[kLanes];   /* 23 bit noise shift register */
+    uint32_t noise_[kLanes];  /* 12 bit noise output */
+    int src_[kLanes];         /* sync and ring mod source lane */
+    uint32_t ring_[kLanes];   /* source accumulator this step */
+    float out_[kLanes];
+    float route_[kLanes];     /* 1 when routed through the filter */
+    float pass_[kLanes];      /* 1 when mixed directly */
+    /* envelopes */
+    uint32_t env_[kLanes];    /* 8 bit envelope counter */
+    uint8_t state_[kLanes];
+    uint8_t adsr_[kLanes][4];
+    uint32_t rate_cnt_[kLanes];
+    uint32_t exp_cnt_[kLanes];
+
+    /* per chip */
+    uint8_t regs_[kMaxChips][0x20];
+    kModel model_[kMaxChips];
+    float lp_[kMaxChips];
+    float bp_[kMaxChips];
+    float w_[kMaxChips];      /* cutoff coefficient */
+    float damp_[kMaxChips];   /* 1/Q */
+    float lpm_[kMaxChips];
+    float bpm_[kMaxChips];
+    float hpm_[kMaxChips];
+    float vol_[kMaxChips];
+    float bias_[kMaxChips];   /* mixer DC, volume register digis */
+    float filt_in_[kMaxChips];
+    float direct_[kMaxChips];
+    int chips_;               /* chips written to so far */
+
+    /* clock and resampler */
+    bool started_;
+    unsigned int clk_;
+    unsigned int rest_;
+    unsigned int phase_;
+    float sum_;
+    unsigned int sum_n_;
+    float dc_x_;
+    float dc_y_;
+
+    /* output */
+    static constexpr size_t kBufSize = 1024;
+    int16_t buf_[kBufSize];
+    size_t fill_;
+    FILE *wav_;
+    unsigned long samples_;
+    bool audio_on_;
+    #if SDL_ENABLED
+    SDL_AudioDeviceID audio_;
+    #endif
+
+    enum kEnvState
+    {
+      kAttack,
+      kDecaySustain,
+      kRelease,
+    };
+
+    void step();
+    void envelope(int l);
+    void update_chip(int c);
+    void emit(float v);
+    void flush_out();
+    void wav_header(uint32_t data_size);
+};
+
+#endif /* DESKTOP */
+
+#endif /* EMUDORE_SIDSYNTH_H */
@@ -0,0 +1,211 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * snapshot.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <c64.h>
+#include <snapshot.h>
+#include <statehash.h>
+
+#if DESKTOP
+
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <unistd.h>
+#include <sys/stat.h>
+#if defined(__APPLE__)
+#include <mach-o/dyld.h>
+#endif
+
+
+bool Snapshot::enabled = true;
+std::string Snapshot::file = "";
+
+static const char kMagic[8] = {'C','6','4','S','N','A','P','1'};
+static const size_t kHeaderSize = (8 + 8 + 4);
+
+// location ////////////////////////////////////////////////////////////////
+
+static bool is_dir(const std::string &path)
+{
+  struct stat st;
+  return (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+/**
+ * @brief folder the executable was started from
+ * Falls back to the folder in argv[0], then the working folder
+ */
+static std::string exe_dir(const char *argv0)
+{
+  char buf[PATH_MAX];
+  std::string path;
+  #if defined(__linux__)
+  ssize_t n = readlink("/proc/self/exe", buf, (sizeof(buf) - 1));
+  if (n > 0) path.assign(buf, n);
+  #elif defined(__APPLE__)
+  uint32_t size = sizeof(buf);
+  if (_NSGetExecutablePath(buf, &size) == 0) path = buf;
+  #endif
+  if (path.empty() && argv0 != nullptr) path = argv0;
+  size_t slash = path.rfind('/');
+  if (slash == std::string::npos) return ".";
+  return path.substr(0, (slash == 0 ? 1 : slash));
+}
+
+/**
+ * @brief pick the snapshot file when none is set
+ *
+ * Kept with the ROM images given with -roms, otherwise in the
+ * assets/roms folder next to the executable or one up from it
+ * (a build folder in the source tree), otherwise next to the
+ * executable, so the working folder doesn't matter.
+ */
+void Snapshot::locate(const char *argv0)
+{
+  if (!file.empty()) return;
+  std::string dir;
+  if (!Memory::rom_path.empty()) {
+    dir = Memory::rom_path;
+  } else {
+    std::string exe = exe_dir(argv0);
+    if (is_dir(exe + "/assets/roms")) dir = (exe + "/assets/roms");
+    else if (is_dir(exe + "/../assets/roms")) dir = (exe + "/../assets/roms");
+    else dir = exe;
+  }
+  file = (dir + "/boot.snapshot");
+  D("[SNAP] Boot snapshot %s\n", file.c_str());
+}
+
+// ctor //////////////////////////////////////////////////////////////////////
+
+Snapshot::Snapshot(C64 *c64) :
+  c64_(c64),
+  pos_(0),
+  restoring_(false)
+{
+  Memory *mem = c64_->mem_;
+  key_ = StateHash::hash64(mem->basic_rom(), Memory::kBasicSize, kVersion);
+  key_ = StateHash::hash64(mem->chargen_rom(), Memory::kChargenSize, key_);
+  key_ = StateHash::hash64(mem->kernal_rom(), Memory::kKernalSize, key_);
+}
+
+// state /////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief copy a field into the state on save,
+ * or back out of it on restore
+ */
+void Snapshot::io(void *p, size_t n)
+{
+  if (restoring_) {
+    memcpy(p, &state_[pos_], n);
+    pos_ += n;
+  } else {
+    const uint8_t *b = (const uint8_t *)p;
+    state_.insert(state_.end(), b, b + n);
+  }
+}
+
+void Snapshot::walk()
+{
+  c64_->cpu_->snapshot(*this);
+  c64_->mem_->snapshot(*this);
+  c64_->pla_->snapshot(*this);
+  c64_->cia1_->snapshot(*this);
+  c64_->cia2_->snapshot(*this);
+  c64_->vic_->snapshot(*this);
+}
+
+// file //////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief restore the machine from the snapshot file
+ * @return false if there is no snapshot for this ROM set,
+ * the machine is left untouched then
+ */
+bool Snapshot::restore()
+{
+  FILE *f = fopen(file.c_str(), "rb");
+  if (f == nullptr) return false;
+
+  /* a save pass over the current machine gives the expected size */
+  state_.clear();
+  restoring_ = false;
+  walk();
+
+  uint8_t hdr[kHeaderSize];
+  uint64_t key = 0;
+  uint32_t size = 0;
+  bool ok = (fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr)
+    && memcmp(hdr, kMagic, 8) == 0);
+  for(int b = 0 ; b < 8 ; b++) key |= ((uint64_t)hdr[8 + b] << (b * 8));
+  for(int b = 0 ; b < 4 ; b++) size |= ((uint32_t)hdr[16 + b] << (b * 8));
+  ok = (ok && key == key_ && size == state_.size()
+    && fread(state_.data(), 1, size, f) == size);
+  fclose(f);
+  if (!ok) {
+    D("[SNAP] %s does not match this ROM set\n", file.c_str());
+    return false;
+  }
+
+  pos_ = 0;
+  restoring_ = true;
+  walk();
+  restoring_ = false;
+  D("[SNAP] Restored %s\n", file.c_str());
+  return true;
+}
+
+/**
+ * @brief save the current machine state
+ * Written to a temporary file first so an interrupted
+ * save never leaves a truncated snapshot behind
+ */
+bool Snapshot::save()
+{
+  state_.clear();
+  restoring_ = false;
+  walk();
+
+  uint8_t hdr[kHeaderSize];
+  uint32_t size = state_.size();
+  memcpy(hdr, kMagic, 8);
+  for(int b = 0 ; b < 8 ; b++) hdr[8 + b] = ((key_ >> (b * 8)) & 0xff);
+  for(int b = 0 ; b < 4 ; b++) hdr[16 + b] = ((size >> (b * 8)) & 0xff);
+
+  std::string tmp = file + ".tmp";
+  FILE *f = fopen(tmp.c_str(), "wb");
+  if (f == nullptr) {
+    fprintf(stderr, "[SNAP] Unable to open %s for writing\n", tmp.c_str());
+    return false;
+  }
+  bool ok = (fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr)
+    && fwrite(state_.data(), 1, size, f) == size);
+  ok = ((fclose(f) == 0) && ok);
+  if (!ok || rename(tmp.c_str(), file.c_str()) != 0) {
+    fprintf(stderr, "[SNAP] Unable to write %s\n", file.c_str());
+    remove(tmp.c_str());
+    return false;
+  }
+  printf("[SNAP] Boot snapshot saved to %s\n", file.c_str());
+  return true;
+}
+
+#endif /* DESKTOP */
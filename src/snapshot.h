@@ -0,0 +1,83 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * snapshot.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_SNAPSHOT_H
+#define EMUDORE_SNAPSHOT_H
+
+#if DESKTOP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/**
+ * @brief Boot snapshot
+ *
+ * The KERNAL cold start (RAM test, screen and BASIC init) takes
+ * about 2.5 million cycles before the READY prompt. The machine
+ * state at that point is the same on every launch with the same
+ * ROMs, so it is saved once and restored on later launches.
+ *
+ * Every component writes and reads its state through one
+ * snapshot() method, io() copies a field out on save and back
+ * in on restore, so the order can not get out of step.
+ *
+ * File layout, all values little endian:
+ *
+ *  header  "C64SNAP1" u64 key, u32 state size
+ *  state   cpu, memory, pla, cia1, cia2, vic
+ *
+ * The key hashes the loaded ROM images and the snapshot version,
+ * a changed ROM set or state layout discards the file.
+ * SID, cart and io state are not part of the snapshot, the
+ * KERNAL boot does not touch them.
+ */
+class Snapshot
+{
+  public:
+    Snapshot(C64 *c64);
+
+    bool restore();
+    bool save();
+
+    /* field access for the components */
+    void io(void *p, size_t n);
+    template <typename T> void io(T &v){io(&v, sizeof(T));};
+
+    static bool enabled;
+    static std::string file;
+    static void locate(const char *argv0);
+
+    static constexpr uint32_t kVersion = 1;
+
+  private:
+    C64 *c64_;
+    uint64_t key_;
+    std::vector<uint8_t> state_;
+    size_t pos_;
+    bool restoring_;
+
+    void walk();
+};
+
+#endif /* DESKTOP */
+
+#endif /* EMUDORE_SNAPSHOT_H */
@@ -0,0 +1,330 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * statehash.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <c64.h>
+#include <statehash.h>
+
+#if DESKTOP
+
+#include <cstring>
+
+
+std::string StateHash::log_file = "";
+
+const char *StateHash::kComponentNames[kComponents] = {
+  "framebuffer",
+  "ram",
+  "colorram",
+  "cpu",
+  "cia1",
+  "cia2",
+  "vic",
+};
+
+static const char kMagic[8] = {'C','6','4','H','A','S','H','1'};
+static const size_t kRecordSize = (4 + (8 * StateHash::kComponents));
+
+// hash //////////////////////////////////////////////////////////////////////
+
+static const uint64_t kPrime1 = 0x9e3779b185ebca87ULL;
+static const uint64_t kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+static const uint64_t kPrime3 = 0x165667b19e3779f9ULL;
+static const uint64_t kPrime4 = 0x85ebca77c2b2ae63ULL;
+static const uint64_t kPrime5 = 0x27d4eb2f165667c5ULL;
+
+static inline uint64_t rotl64(uint64_t v, int r)
+{
+  return ((v << r) | (v >> (64 - r)));
+}
+
+static inline uint64_t read64(const uint8_t *p)
+{
+  uint64_t v;
+  memcpy(&v, p, sizeof(v)); /* unaligned safe, host is little endian */
+  return v;
+}
+
+static inline uint64_t round64(uint64_t acc, uint64_t in)
+{
+  acc += (in * kPrime2);
+  acc = rotl64(acc, 31);
+  return (acc * kPrime1);
+}
+
+static inline uint64_t merge64(uint64_t acc, uint64_t v)
+{
+  acc ^= round64(0, v);
+  return ((acc * kPrime1) + kPrime4);
+}
+
+/**
+ * @brief 64 bit hash (xxHash64)
+ *
+ * The bulk loop runs four independent accumulators over
+ * 32 byte stripes, which the compiler turns into vector
+ * code, the tail is folded in 8, 4 and 1 byte steps.
+ */
+uint64_t StateHash::hash64(const void *data, size_t len, uint64_t seed)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  const uint8_t *end = p + len;
+  uint64_t h;
+
+  if (len >= 32) {
+    uint64_t acc[4] = {
+      seed + kPrime1 + kPrime2,
+      seed + kPrime2,
+      seed,
+      seed - kPrime1,
+    };
+    const uint8_t *limit = end - 32;
+    do {
+      for(int l = 0 ; l < 4 ; l++)
+      {
+        acc[l] = round64(acc[l], read64(p + (l * 8)));
+      }
+      p += 32;
+    } while (p <= limit);
+    h = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) + rotl64(acc[3], 18);
+    for(int l = 0 ; l < 4 ; l++)
+    {
+      h = merge64(h, acc[l]);
+    }
+  } else {
+    h = seed + kPrime5;
+  }
+  h += (uint64_t)len;
+
+  while ((p + 8) <= end) {
+    h ^= round64(0, read64(p));
+    h = (rotl64(h, 27) * kPrime1) + kPrime4;
+    p += 8;
+  }
+  if ((p + 4) <= end) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    h ^= ((uint64_t)v * kPrime1);
+    h = (rotl64(h, 23) * kPrime2) + kPrime3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= ((uint64_t)(*p) * kPrime5);
+    h = rotl64(h, 11) * kPrime1;
+    p++;
+  }
+
+  /* avalanche */
+  h ^= (h >> 33);
+  h *= kPrime2;
+  h ^= (h >> 29);
+  h *= kPrime3;
+  h ^= (h >> 32);
+  return h;
+}
+
+// ctor and dtor /////////////////////////////////////////////////////////////
+
+StateHash::StateHash(C64 *c64, const std::string &path) :
+  c64_(c64),
+  frame_(0)
+{
+  out_ = fopen(path.c_str(), "wb");
+  if (out_ == nullptr) {
+    fprintf(stderr, "[HASH] Unable to open %s for writing\n", path.c_str());
+    return;
+  }
+  uint8_t hdr[12];
+  memcpy(hdr, kMagic, 8);
+  for(int b = 0 ; b < 4 ; b++) hdr[8 + b] = (((uint32_t)kComponents >> (b * 8)) & 0xff);
+  fwrite(hdr, 1, sizeof(hdr), out_);
+  D("[EMU] StateHash initialized.\n");
+}
+
+StateHash::~StateHash()
+{
+  if (out_ != nullptr) {
+    fclose(out_);
+    printf("[HASH] %u frames logged\n", frame_);
+  }
+}
+
+// state /////////////////////////////////////////////////////////////////////
+
+uint64_t StateHash::hash_cpu()
+{
+  Cpu *cpu = c64_->cpu_;
+  uint8_t s[11];
+  unsigned int cycles = cpu->cycles();
+  s[0] = (cpu->pc() & 0xff);
+  s[1] = (cpu->pc() >> 8);
+  s[2] = cpu->a();
+  s[3] = cpu->x();
+  s[4] = cpu->y();
+  s[5] = cpu->sp();
+  s[6] = 0;
+  for(int b = 0 ; b < 8 ; b++)
+  {
+    if (cpu->getflag(1 << b)) s[6] |= (1 << b);
+  }
+  for(int b = 0 ; b < 4 ; b++) s[7 + b] = ((cycles >> (b * 8)) & 0xff);
+  return hash64(s, sizeof(s));
+}
+
+uint64_t StateHash::hash_cia(const CiaRegs &r)
+{
+  /* packed field by field, the struct has padding */
+  unsigned int now = c64_->cpu_->cycles();
+  uint16_t ta = r.ta.counter(now);
+  uint16_t tb = r.tb.counter(now);
+  uint8_t s[] = {
+    r.pra, r.prb, r.ddra, r.ddrb,
+    r.tod[0], r.tod[1], r.tod[2], r.tod[3],
+    r.sdr, r.icr_mask, r.icr, r.cra, r.crb,
+    (uint8_t)(r.ta.latch & 0xff), (uint8_t)(r.ta.latch >> 8),
+    (uint8_t)(ta & 0xff), (uint8_t)(ta >> 8),
+    (uint8_t)(r.tb.latch & 0xff), (uint8_t)(r.tb.latch >> 8),
+    (uint8_t)(tb & 0xff), (uint8_t)(tb >> 8),
+  };
+  return hash64(s, sizeof(s));
+}
+
+uint64_t StateHash::hash_vic()
+{
+  Vic *vic = c64_->vic_;
+  uint8_t s[0x2f + 2];
+  for(uint8_t r = 0 ; r < 0x2f ; r++)
+  {
+    s[r] = vic->peek_register(r);
+  }
+  int rstr = vic->raster_counter();
+  s[0x2f] = (rstr & 0xff);
+  s[0x30] = ((rstr >> 8) & 0xff);
+  return hash64(s, sizeof(s));
+}
+
+/**
+ * @brief hash and log the current frame
+ * Called from vic->emulate() at the frame boundary
+ */
+void StateHash::record(bool rendered)
+{
+  if (out_ == nullptr) return;
+  const uint8_t *ram = c64_->mem_->mem_ram();
+  uint64_t h[kComponents];
+
+  h[kFrame] = (rendered
+    ? hash64(c64_->io_->frame(), c64_->io_->frame_size() * sizeof(uint32_t))
+    : 0);
+  /* $d000-$dfff is covered by the color ram, cia and vic hashes */
+  h[kRam] = hash64(&ram[0xe000], 0x2000, hash64(ram, 0xd000));
+  h[kColorRam] = hash64(&ram[Memory::kAddrColorRAM], 0x400);
+  h[kCpu] = hash_cpu();
+  h[kCia1] = hash_cia(c64_->cia1_->regs());
+  h[kCia2] = hash_cia(c64_->cia2_->regs());
+  h[kVic] = hash_vic();
+
+  uint8_t rec[kRecordSize];
+  size_t i = 0;
+  for(int b = 0 ; b < 4 ; b++) rec[i++] = ((frame_ >> (b * 8)) & 0xff);
+  for(int c = 0 ; c < kComponents ; c++)
+  {
+    for(int b = 0 ; b < 8 ; b++) rec[i++] = ((h[c] >> (b * 8)) & 0xff);
+  }
+  fwrite(rec, 1, i, out_);
+  frame_++;
+}
+
+// compare ///////////////////////////////////////////////////////////////////
+
+static FILE *open_log(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  if (f == nullptr) {
+    fprintf(stderr, "[HASH] Unable to open %s\n", path);
+    return nullptr;
+  }
+  uint8_t hdr[12];
+  if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr)
+      || memcmp(hdr, kMagic, 8) != 0
+      || hdr[8] != StateHash::kComponents) {
+    fprintf(stderr, "[HASH] %s is not a state hash log\n", path);
+    fclose(f);
+    return nullptr;
+  }
+  return f;
+}
+
+/**
+ * @brief compare two hash logs
+ *
+ * Reports the first frame that differs and which components
+ * differ in that frame, framebuffer hashes are only compared
+ * when both runs rendered the frame.
+ *
+ * @return 0 on match, 1 on divergence, 2 on error
+ */
+int StateHash::compare(const char *a, const char *b)
+{
+  FILE *fa = open_log(a);
+  FILE *fb = open_log(b);
+  if (fa == nullptr || fb == nullptr) {
+    if (fa != nullptr) fclose(fa);
+    if (fb != nullptr) fclose(fb);
+    return 2;
+  }
+  uint8_t ra[kRecordSize], rb[kRecordSize];
+  unsigned int frames = 0;
+  int result = 0;
+  while (true) {
+    bool ha = (fread(ra, 1, kRecordSize, fa) == kRecordSize);
+    bool hb = (fread(rb, 1, kRecordSize, fb) == kRecordSize);
+    if (!ha || !hb) {
+      if (ha != hb) {
+        printf("[HASH] %u frames match, %s has more frames\n", frames, (ha ? a : b));
+      } else {
+        printf("[HASH] %u frames match\n", frames);
+      }
+      break;
+    }
+    if (memcmp(ra, rb, kRecordSize) != 0) {
+      std::string diverged;
+      for(int c = 0 ; c < kComponents ; c++)
+      {
+        const uint8_t *pa = &ra[4 + (c * 8)];
+        const uint8_t *pb = &rb[4 + (c * 8)];
+        if (memcmp(pa, pb, 8) == 0) continue;
+        if (c == kFrame && (read64(pa) == 0 || read64(pb) == 0)) continue; /* skipped */
+        if (!diverged.empty()) diverged += ", ";
+        diverged += kComponentNames[c];
+      }
+      if (!diverged.empty()) {
+        printf("[HASH] first divergence at frame %u: %s\n", frames, diverged.c_str());
+        result = 1;
+        break;
+      }
+    }
+    frames++;
+  }
+  fclose(fa);
+  fclose(fb);
+  return result;
+}
+
+#endif /* DESKTOP */
@@ -0,0 +1,85 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * statehash.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_STATEHASH_H
+#define EMUDORE_STATEHASH_H
+
+#if DESKTOP
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+
+
+/**
+ * @brief Per frame machine state hashing
+ *
+ * At every frame boundary the framebuffer, RAM, color RAM and
+ * the CPU, CIA and VIC register state are hashed separately and
+ * appended to a log. Two logs (two runs or two builds) are then
+ * compared frame by frame to find the first divergence.
+ *
+ * Log layout, all values little endian:
+ *
+ *  header  "C64HASH1" u32 number of components
+ *  frame   u32 frame number, u64 hash per component
+ *
+ * Skipped frames (frame skip) log a framebuffer hash of 0.
+ */
+class StateHash
+{
+  public:
+    enum kComponent
+    {
+      kFrame,
+      kRam,
+      kColorRam,
+      kCpu,
+      kCia1,
+      kCia2,
+      kVic,
+      kComponents,
+    };
+    static const char *kComponentNames[kComponents];
+
+    StateHash(C64 *c64, const std::string &path);
+    ~StateHash();
+
+    bool ok(){return out_ != nullptr;};
+    void record(bool rendered);
+
+    static uint64_t hash64(const void *data, size_t len, uint64_t seed = 0);
+    static int compare(const char *a, const char *b);
+
+    static std::string log_file;
+
+  private:
+    C64 *c64_;
+    FILE *out_;
+    unsigned int frame_;
+
+    uint64_t hash_cpu();
+    uint64_t hash_cia(const CiaRegs &r);
+    uint64_t hash_vic();
+};
+
+#endif /* DESKTOP */
+
+#endif /* EMUDORE_STATEHASH_H */
@@ -0,0 +1,254 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * usbsidmock.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <util.h>
+#include <usbsidmock.h>
+#include <sidbackend.h>
+
+#if DESKTOP
+
+#include <cstring>
+#include <thread>
+
+
+unsigned int UsbsidMock::latency_us = 1000; /* one full speed USB frame */
+unsigned int UsbsidMock::jitter_us = 0;
+
+/* inclusive upper bounds of the histogram buckets, the last is open */
+static const uint64_t kRateEdges[] = {0, 4, 8, 16, 32, 64, 128};
+static const uint64_t kErrorEdges[] = {0, 8, 64, 256, 1024, 4096, 16384};
+/* eighth, quarter and half a PAL frame, one frame +-64 cycles, two and four */
+static const uint64_t kGapEdges[] = {2457, 4914, 9828, 19592, 19720, 39312, 78624};
+
+UsbsidMock::UsbsidMock() :
+  open_(false),
+  clock_(PAL),
+  rng_(1),
+  cycles_(0),
+  started_(false),
+  writes_(0),
+  late_(0),
+  error_sum_(0),
+  error_max_(0),
+  frame_start_(0),
+  frame_writes_(0),
+  frames_(0),
+  rate_max_(0),
+  flushes_(0),
+  flush_cycles_(0),
+  gap_sum_(0),
+  gap_min_(~0ull),
+  gap_max_(0),
+  blocked_(0),
+  reads_(0)
+{
+  memset(regs_, 0, sizeof(regs_));
+  memset(error_hist_, 0, sizeof(error_hist_));
+  memset(rate_hist_, 0, sizeof(rate_hist_));
+  memset(gap_hist_, 0, sizeof(gap_hist_));
+}
+
+UsbsidMock::~UsbsidMock()
+{
+  if (open_) USBSID_Close();
+}
+
+int UsbsidMock::USBSID_Init(bool start_threaded, bool with_cycles)
+{
+  (void)start_threaded;
+  (void)with_cycles;
+  open_ = true;
+  if (SidBackend::log_stats) printf("[USBSIDMOCK] USB latency %uus, jitter %uus\n", latency_us, jitter_us);
+  return 0;
+}
+
+void UsbsidMock::USBSID_SetClockRate(long clock, bool suspend_sids)
+{
+  (void)suspend_sids;
+  if (clock > 0) clock_ = clock;
+}
+
+/**
+ * @brief the device timeline restarts with the next access
+ */
+void UsbsidMock::USBSID_Reset()
+{
+  memset(regs_, 0, sizeof(regs_));
+  started_ = false;
+}
+
+void UsbsidMock::USBSID_Close()
+{
+  if (!open_) return;
+  open_ = false;
+  if (SidBackend::log_stats) report();
+}
+
+/**
+ * @brief device starts playing when the first data arrives
+ */
+void UsbsidMock::start()
+{
+  started_ = true;
+  epoch_ = (clock_t::now() + std::chrono::microseconds(latency_us));
+  cycles_ = 0;
+  frame_start_ = 0;
+  frame_writes_ = 0;
+  flush_cycles_ = 0;
+}
+
+/**
+ * @brief move the host clock, counting writes per frame
+ */
+void UsbsidMock::advance(unsigned int cycles)
+{
+  cycles_ += cycles;
+  while ((cycles_ - frame_start_) >= kFrameCycles) {
+    rate_hist_[bucket(frame_writes_, kRateEdges)]++;
+    if (frame_writes_ > rate_max_) rate_max_ = frame_writes_;
+    frames_++;
+    frame_writes_ = 0;
+    frame_start_ += kFrameCycles;
+  }
+}
+
+UsbsidMock::clock_t::time_point UsbsidMock::due(uint64_t cycle)
+{
+  return (epoch_ + std::chrono::nanoseconds((cycle * 1000000000ULL) / clock_));
+}
+
+void UsbsidMock::USBSID_WriteRingCycled(uint8_t reg, uint8_t val, uint16_t cycles)
+{
+  if (!open_) return;
+  if (!started_) start();
+  advance(cycles);
+  clock_t::time_point now = clock_t::now();
+  unsigned int jitter = ((jitter_us != 0)
+    ? std::uniform_int_distribution<unsigned int>(0, jitter_us)(rng_) : 0);
+  clock_t::time_point arrival = (now + std::chrono::microseconds(latency_us + jitter));
+  clock_t::time_point play = due(cycles_);
+  uint64_t error = 0;
+  if (arrival > play) {
+    /* played on arrival, everything after it moves back */
+    auto late = std::chrono::duration_cast<std::chrono::nanoseconds>(arrival - play);
+    error = (((uint64_t)late.count() * clock_) / 1000000000ULL);
+    epoch_ += late;
+    late_++;
+  }
+  error_hist_[bucket(error, kErrorEdges)]++;
+  error_sum_ += error;
+  if (error > error_max_) error_max_ = error;
+  regs_[(reg & 0x7f)] = val;
+  writes_++;
+  frame_writes_++;
+  /* the device buffer is full, wait for room */
+  if ((play - now) > std::chrono::milliseconds(kBufferMs)) {
+    blocked_++;
+    std::this_thread::sleep_until(play - std::chrono::milliseconds(kBufferMs));
+  }
+}
+
+/**
+ * @brief host side wait, keeps the host one latency ahead
+ */
+void UsbsidMock::USBSID_WaitForCycle(uint16_t cycles)
+{
+  if (!open_) return;
+  if (!started_) start();
+  advance(cycles);
+  std::this_thread::sleep_until(due(cycles_) - std::chrono::microseconds(latency_us));
+}
+
+/**
+ * @brief the host flushed up to the current cycle
+ * Not a driver call, long gaps take several waits per flush
+ */
+void UsbsidMock::flushed()
+{
+  if (!open_ || !started_) return;
+  if (flushes_ != 0) {
+    uint64_t gap = (cycles_ - flush_cycles_);
+    gap_hist_[bucket(gap, kGapEdges)]++;
+    gap_sum_ += gap;
+    if (gap < gap_min_) gap_min_ = gap;
+    if (gap > gap_max_) gap_max_ = gap;
+  }
+  flush_cycles_ = cycles_;
+  flushes_++;
+}
+
+/**
+ * @brief last value written, after a USB round trip
+ */
+uint8_t UsbsidMock::USBSID_Read(uint8_t reg)
+{
+  reads_++;
+  std::this_thread::sleep_for(std::chrono::microseconds(2 * latency_us));
+  return regs_[(reg & 0x7f)];
+}
+
+int UsbsidMock::bucket(uint64_t v, const uint64_t *edges)
+{
+  int b = 0;
+  while (b < (kBuckets - 1) && v > edges[b]) b++;
+  return b;
+}
+
+void UsbsidMock::print_hist(const char *title, const unsigned long *hist,
+  const uint64_t *edges)
+{
+  unsigned long total = 0;
+  for (int b = 0; b < kBuckets; b++) total += hist[b];
+  if (total == 0) return;
+  printf("[USBSIDMOCK] %s\n", title);
+  for (int b = 0; b < kBuckets; b++) {
+    char range[32];
+    if (b == 0) snprintf(range, sizeof(range), "<= %llu", (unsigned long long)edges[0]);
+    else if (b == (kBuckets - 1)) snprintf(range, sizeof(range), "> %llu", (unsigned long long)edges[b - 1]);
+    else snprintf(range, sizeof(range), "%llu - %llu",
+      (unsigned long long)(edges[b - 1] + 1), (unsigned long long)edges[b]);
+    printf("  %-16s : %8lu %5.1f%%\n", range, hist[b], ((100.0 * hist[b]) / total));
+  }
+}
+
+void UsbsidMock::report()
+{
+  printf("[USBSIDMOCK] %lu writes, %lu flushes, %lu reads, blocked %lu times on a full buffer\n",
+    writes_, flushes_, reads_, blocked_);
+  if (frames_ != 0) {
+    printf("[USBSIDMOCK] writes per frame avg %.1f max %u over %lu frames\n",
+      ((double)writes_ / frames_), rate_max_, frames_);
+    print_hist("writes per frame", rate_hist_, kRateEdges);
+  }
+  if (writes_ != 0) {
+    printf("[USBSIDMOCK] %lu writes late (%.2f%%), cycle error avg %.1f max %llu\n",
+      late_, ((100.0 * late_) / writes_), ((double)error_sum_ / writes_),
+      (unsigned long long)error_max_);
+    print_hist("cycle error", error_hist_, kErrorEdges);
+  }
+  if (flushes_ > 1) {
+    printf("[USBSIDMOCK] cycles between flushes min %llu avg %.1f max %llu\n",
+      (unsigned long long)gap_min_, ((double)gap_sum_ / (flushes_ - 1)),
+      (unsigned long long)gap_max_);
+    print_hist("cycles between flushes", gap_hist_, kGapEdges);
+  }
+}
+
+#endif /* DESKTOP */
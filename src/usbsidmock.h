@@ -0,0 +1,123 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * usbsidmock.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_USBSIDMOCK_H
+#define EMUDORE_USBSIDMOCK_H
+
+#if DESKTOP
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+
+/**
+ * @brief stand-in for the USBSID-Pico driver
+ *
+ * Has the driver calls the emulator uses and a model of the
+ * device behind them, so the SID write path can be measured
+ * without the hardware.
+ *
+ * Every write is stamped with the emulated cycle it was sent
+ * for and reaches the device after the USB latency plus a
+ * random jitter. The device plays it at its due time on its
+ * own clock, or on arrival when it came in late, which pushes
+ * everything after it back. How late, in cycles, is the cycle
+ * error of the write.
+ *
+ * Like the hardware the mock keeps the host in real time,
+ * USBSID_WaitForCycle() sleeps and writes block when more than
+ * kBufferMs of them are waiting to be played.
+ *
+ * The report printed on close has the writes per frame, the
+ * cycle error distribution and the gaps between flushes.
+ */
+class UsbsidMock
+{
+  public:
+    UsbsidMock();
+    ~UsbsidMock();
+
+    /* driver surface */
+    int USBSID_Init(bool start_threaded, bool with_cycles);
+    void USBSID_SetClockRate(long clock, bool suspend_sids);
+    void USBSID_Reset();
+    void USBSID_Close();
+    void USBSID_WriteRingCycled(uint8_t reg, uint8_t val, uint16_t cycles);
+    void USBSID_WaitForCycle(uint16_t cycles);
+    uint8_t USBSID_Read(uint8_t reg);
+
+    void flushed();
+
+    static constexpr long PAL = 985248;
+
+    /* configured from the command line */
+    static unsigned int latency_us;
+    static unsigned int jitter_us;
+
+  private:
+    typedef std::chrono::steady_clock clock_t;
+
+    static constexpr int kBuckets = 8;
+    static constexpr int kBufferMs = 20;
+    static constexpr unsigned int kFrameCycles = 19656; /* PAL */
+
+    bool open_;
+    long clock_;
+    uint8_t regs_[0x80];
+    std::mt19937 rng_;
+
+    /* device timeline */
+    clock_t::time_point epoch_;   /* device time of cycle 0 */
+    uint64_t cycles_;             /* cycles sent by the host */
+    bool started_;
+
+    /* statistics */
+    unsigned long writes_;
+    unsigned long late_;
+    uint64_t error_sum_;
+    uint64_t error_max_;
+    unsigned long error_hist_[kBuckets];
+    uint64_t frame_start_;
+    unsigned int frame_writes_;
+    unsigned long frames_;
+    unsigned int rate_max_;
+    unsigned long rate_hist_[kBuckets];
+    unsigned long flushes_;
+    uint64_t flush_cycles_;       /* cycles at the previous flush */
+    uint64_t gap_sum_;
+    uint64_t gap_min_;
+    uint64_t gap_max_;
+    unsigned long gap_hist_[kBuckets];
+    unsigned long blocked_;
+    unsigned long reads_;
+
+    void start();
+    void advance(unsigned int cycles);
+    clock_t::time_point due(uint64_t cycle);
+    void report();
+    static int bucket(uint64_t v, const uint64_t *edges);
+    static void print_hist(const char *title, const unsigned long *hist,
+      const uint64_t *edges);
+};
+
+#endif /* DESKTOP */
+
+#endif /* EMUDORE_USBSIDMOCK_H */
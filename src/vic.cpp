@@ -19,22 +19,46 @@
  */
 
 #include <c64.h> /* All classes are loaded through c64.h */
+#include <snapshot.h>
+#include <statehash.h>
 
+#include <cstring>
+
+
+int Vic::frame_skip = 1;
 
 // ctor and emulate()  ///////////////////////////////////////////////////////
 
 Vic::Vic(C64 *c64) :
   c64_(c64)
 {
+  #if DESKTOP
+  renderer_ = new VicRenderer(c64);
+  statehash_ = nullptr;
+  if(!StateHash::log_file.empty()) {
+    statehash_ = new StateHash(c64, StateHash::log_file);
+  }
+  #endif
   reset();
 }
 
+Vic::~Vic()
+{
+  #if DESKTOP
+  delete renderer_;
+  if(statehash_ != nullptr) delete statehash_;
+  #endif
+}
+
 /* Used on C64/CPU reset */
 void Vic::reset()
 {
   /* raster */
   raster_irq_ = raster_c_ = 0;
   irq_enabled_ = irq_status_ = 0;
+  irq_line();
+  /* light pen */
+  lightpen_x_ = lightpen_y_ = 0;
   prev_next_raster_at_ = next_raster_at_ = kLineCycles;
   sprite_sprite_collision_ = 0;
   sprite_bgnd_collision_ = 0;
@@ -62,24 +86,72 @@ void Vic::reset()
   mem_pointers_ = (1 << 0);
   /* current graphic mode */
   graphic_mode_ = kCharMode;
+  /* frame skipping */
+  frame_skip_c_ = 0;
+  auto_skip_ = 1;
+  frame_load_ = 0.0;
+  render_frame_ = true;
 
   D("[EMU] Vic initialized.\n");
 }
 
+#if DESKTOP
+/**
+ * @brief save or restore registers and raster timing
+ * Frame skipping and the renderer start over
+ */
+void Vic::snapshot(Snapshot &s)
+{
+  s.io(mx_);
+  s.io(my_);
+  s.io(msbx_);
+  s.io(sprite_enabled_);
+  s.io(sprite_priority_);
+  s.io(sprite_multicolor_);
+  s.io(sprite_double_width_);
+  s.io(sprite_sprite_collision_);
+  s.io(sprite_bgnd_collision_);
+  s.io(sprite_double_height_);
+  s.io(sprite_shared_colors_);
+  s.io(sprite_colors_);
+  s.io(border_color_);
+  s.io(bgcolor_);
+  s.io(next_raster_at_);
+  s.io(prev_next_raster_at_);
+  s.io(frame_c);
+  s.io(prev_frame_c_);
+  s.io(frame_c_);
+  s.io(cr1_);
+  s.io(cr2_);
+  s.io(raster_c_);
+  s.io(raster_irq_);
+  s.io(lightpen_x_);
+  s.io(lightpen_y_);
+  s.io(irq_status_);
+  s.io(irq_enabled_);
+  s.io(screen_mem_);
+  s.io(char_mem_);
+  s.io(bitmap_mem_);
+  s.io(mem_pointers_);
+  s.io(graphic_mode_);
+}
+#endif
+
+/**
+ * @brief drive the cpu IRQ line
+ * Active for as long as a latched source is unacknowledged
+ */
+inline void Vic::irq_line()
+{
+  c64_->cpu_->irq_line(Cpu::kIrqVic, (irq_status_ & 0xf) != 0);
+}
+
 // returns true on vertical sync
 bool Vic::emulate()
 {
   bool verticalSync = false;
   static unsigned int cycles, vic_cpu_clock;
   static int prev_rstr;
-  /**
-   * if there are unacknowledged interrupts
-   * raise an interrupt again
-   **/
-  if((read_register(0x19) & 0x80) != 0)
-  {
-    c64_->cpu_->irq();
-  }
   /* are we at the next raster line? */
   if (c64_->cpu_->cycles() >= next_raster_at_)
   {
@@ -91,34 +163,24 @@ bool Vic::emulate()
       /* set interrupt origin (raster) */
       irq_status_ |= (1<<0);
     }
-    if(irq_status_){  /* raise interrupt */
-      c64_->cpu_->irq();
-    }
+    /* collision sources are latched while drawing, so update per line */
+    irq_line();
     if (rstr >= kFirstVisibleLine &&
         rstr < kLastVisibleLine)
     {
       #if DESKTOP
-      /* draw border */
-      int screen_y = rstr - kFirstVisibleLine;
-      c64_->io_->screen_draw_border(screen_y,border_color_);
-      /* draw raster on current graphic mode */
-      switch(graphic_mode_)
+      if (render_frame_)
+      {
+        /* hand the line over to the renderer thread */
+        VicLine *l = renderer_->acquire();
+        fetch_raster_line(l,rstr);
+        renderer_->publish();
+      }
+      else
       {
-      case kCharMode:
-      case kMCCharMode:
-      case kExtBgMode:
-        draw_raster_char_mode();
-        break;
-      case kBitmapMode:
-      case kMCBitmapMode:
-        draw_raster_bitmap_mode();
-        break;
-      default:
-        D("unsupported graphic mode: %d\n",graphic_mode_);
-        return false;
+        /* skipped frame, collisions still need updating */
+        fetch_raster_sprites(nullptr,rstr);
       }
-      /* draw sprites */
-      draw_raster_sprites();
       #endif
     }
     /* next raster */
@@ -142,7 +204,18 @@ bool Vic::emulate()
       //   raster_irq_, raster_irq_enabled(), (raster_irq_enabled()?(rstr == raster_irq_):0), kScreenLines, cycles);
       verticalSync=true;
       /* c64_->sid_->sid_flush(); */ /* FLUSH */
+      #if DESKTOP
+      if (render_frame_) {
+        renderer_->sync(); /* frame must be complete before upload */
+      }
+      if(statehash_ != nullptr) {
+        statehash_->record(render_frame_);
+      }
+      c64_->io_->screen_refresh(render_frame_);
+      update_frame_skip();
+      #else
       c64_->io_->screen_refresh();
+      #endif
       cycles=0;
       raster_counter(0);
       if(sprite_sprite_collision_) ISSET_BIT(irq_enabled_,bitMMC); //checkInterrupt(1);
@@ -164,6 +237,9 @@ bool Vic::emulate()
       frame_c = prev_frame_c_ = 0;
       frame_c_ -= kRefrehRate;
       c64_->sid_->reset_cycles(); /* FLUSH */
+      #if DESKTOP
+      c64_->sid_->sync_clock();
+      #endif
       // c64_->sid_->sid_flush(); /* FLUSH */
     }
     prev_frame_c_ = frame_c;
@@ -323,6 +399,23 @@ uint8_t Vic::read_register(uint8_t r)
   return retval;
 }
 
+/**
+ * @brief read a register without side effects
+ * Collision registers are not cleared, used for state hashing
+ */
+uint8_t Vic::peek_register(uint8_t r)
+{
+  switch(r)
+  {
+  case 0x1e:
+    return sprite_sprite_collision_;
+  case 0x1f:
+    return sprite_bgnd_collision_;
+  default:
+    return read_register(r);
+  }
+}
+
 void Vic::write_register(uint8_t r, uint8_t v)
 {
   switch(r)
@@ -400,6 +493,7 @@ void Vic::write_register(uint8_t r, uint8_t v)
   case 0x19:
     /* acknowledge interrupts by mask */
     irq_status_ &= ~(v&0xf);
+    irq_line();
     break;
   /* interrupt enable register */
   case 0x1a:
@@ -548,186 +642,135 @@ uint16_t Vic::get_sprite_ptr(int n)
   return addr;
 }
 
-// raster drawing  ///////////////////////////////////////////////////////////
-
-void Vic::draw_char(int x, int y, uint8_t data, uint8_t color)
-{
-  for(int i=0 ; i < 8 ; i++)
-  {
-    int xoffs = x + 7 - i + horizontal_scroll();
-    /* don't draw outside (due to horizontal scroll) */
-    if(xoffs > kGFirstCol + kGResX)
-      continue;
-    /* draw pixel */
-    if(ISSET_BIT(data,i))
-    {
-      c64_->io_->screen_update_pixel(
-        xoffs,
-        y,
-        color);
-    }
-  }
-}
+// raster fetching /////////////////////////////////////////////////////////
 
-void Vic::draw_ext_backcolor_char(int x, int y, uint8_t data, uint8_t color, uint8_t c)
+#if DESKTOP
+/**
+ * @brief capture everything the renderer needs for this line
+ *
+ * Runs on the emulation thread at the start of a visible raster
+ * line: takes a register snapshot, fetches the video matrix, color
+ * RAM, char/bitmap and sprite bytes and checks sprite-background
+ * collisions so IRQ timing stays on the emulation side.
+ */
+void Vic::fetch_raster_line(VicLine *l, int rstr)
 {
-  c>>=6;
-  for(int i=0 ; i < 8 ; i++)
+  l->raster = rstr;
+  l->cr1 = cr1_;
+  l->cr2 = cr2_;
+  l->border_color = border_color_;
+  memcpy(l->bgcolor,bgcolor_,sizeof(l->bgcolor));
+  l->graphic_mode = graphic_mode_;
+  /* graphics */
+  l->display = ((rstr >= kGFirstLine) &&
+                (rstr < kGLastLine) &&
+                !is_screen_off());
+  if(l->display)
   {
-    int xoffs = x + 7 - i + horizontal_scroll();
-    /* don't draw outside (due to horizontal scroll) */
-    if(xoffs > kGFirstCol + kGResX)
-      continue;
-
-    /* draw pixel */
-    if(ISSET_BIT(data,i))
-    {
-      c64_->io_->screen_update_pixel(xoffs,y,color);
-    }
-    else
+    int line = rstr - kGFirstLine;
+    int row = line/8;
+    int char_row = line % 8;
+    bool bitmap = (graphic_mode_ == kBitmapMode ||
+                   graphic_mode_ == kMCBitmapMode);
+    for(int column=0; column < kGCols ; column++)
     {
-      // if(c >=64 && c <= 127)
-      c64_->io_->screen_update_pixel(xoffs,y,bgcolor_[c]);
-      // if(c >=128 && c <= 191)
-	    // c64_->io_->screen_update_pixel(xoffs,y,bgcolor_[2]);
-      // if(c >=192 && c <= 255)
-      //  c64_->io_->screen_update_pixel(xoffs,y,bgcolor_[3]);
+      uint8_t c = get_screen_char(column,row);
+      l->video[column] = c;
+      l->color[column] = get_char_color(column,row);
+      l->data[column]  = (bitmap
+        ? get_bitmap_data(column,row,char_row)
+        : get_char_data(c,char_row));
     }
   }
+  /* sprites */
+  fetch_raster_sprites(l,rstr);
 }
 
-// void Vic::draw_ext_backcolor_char(int x, int y, uint8_t data, uint8_t color, uint8_t c)
-// {
-//   for(int i=0 ; i < 8 ; i++)
-//   {
-//     int xoffs = x + 8 - i + horizontal_scroll();
-//     /* don't draw outside (due to horizontal scroll) */
-//     if(xoffs > kGFirstCol + kGResX)
-//       continue;
-
-//     /* draw pixel */
-//     if(ISSET_BIT(data,i))
-//     {
-//       c64_->io_->screen_update_pixel(xoffs,y,color);
-//     }
-//     else
-//     {
-//       if(c >=64 && c <= 127)
-// 	      c64_->io_->screen_update_pixel(xoffs,y,bgcolor_[1]);
-//       if(c >=128 && c <= 191)
-// 	      c64_->io_->screen_update_pixel(xoffs,y,bgcolor_[2]);
-//       if(c >=192 && c <= 255)
-// 	      c64_->io_->screen_update_pixel(xoffs,y,bgcolor_[3]);
-//     }
-//   }
-// }
-
-void Vic::draw_mcchar(int x, int y, uint8_t data, uint8_t color)
+/**
+ * @brief fetch sprite data for this line
+ *
+ * Also checks sprite-background collisions, with l == nullptr
+ * only the collision check is done (skipped frames)
+ */
+void Vic::fetch_raster_sprites(VicLine *l, int rstr)
 {
-  for(int i=0 ; i < 4 ; i++)
+  if(l != nullptr)
   {
-    /* color */
-    uint8_t c;
-    /* color source */
-    uint8_t cs = ((data >> i*2) & 0x3);
-    switch(cs)
-    {
-    case 0:
-      c = bgcolor_[0];
-      break;
-    case 1:
-      c = bgcolor_[1];
-      break;
-    case 2:
-      c = bgcolor_[2];
-      break;
-    case 3:
-      c = color;
-      break;
-    }
-    int xoffs = x + 7 - i * 2 + horizontal_scroll();
-    c64_->io_->screen_update_pixel(
-      xoffs,
-      y,
-      c);
-    c64_->io_->screen_update_pixel(
-      xoffs + 1,
-      y,
-      c);
+    l->sprites = 0;
+    l->sprite_multicolor = sprite_multicolor_;
+    l->sprite_double_width = sprite_double_width_;
+    l->sprite_shared_colors[0] = sprite_shared_colors_[0];
+    l->sprite_shared_colors[1] = sprite_shared_colors_[1];
+    memcpy(l->sprite_colors,sprite_colors_,sizeof(l->sprite_colors));
   }
-}
-
-void Vic::draw_raster_char_mode()
-{
-  int rstr = raster_counter();
-  int y = rstr - kFirstVisibleLine;
-  if((rstr >= kGFirstLine) && (rstr < kGLastLine) && !is_screen_off())
+  if(sprite_enabled_ != 0)
   {
-    /* draw background */
-    if(!ISSET_BIT(cr2_,3)) // 38 columns
-      c64_->io_->screen_draw_rect(kGFirstCol+8,y,kGResX-16,bgcolor_[0]);
-    else
-      c64_->io_->screen_draw_rect(kGFirstCol,y,kGResX,bgcolor_[0]);
-
-    /* draw characters */
-    for(int column=0; column < kGCols ; column++)
+    int sp_y = rstr - kSpritesFirstLine;
+    int y_gfx = rstr - kGFirstLine;
+    /* loop over sprites reverse order */
+    for(int n=7; n >= 0 ; n--)
     {
-      /* check 38 cols mode */
-      if(!ISSET_BIT(cr2_,3))
+      int height = is_double_height_sprite(n) ? kSpriteHeight * 2 : kSpriteHeight;
+      /* check if the sprite is visible */
+      if(is_sprite_enabled(n) &&
+         sp_y >= my_[n] &&
+         sp_y < my_[n] + height)
       {
-        if (column == 0) continue;
-        if (column == kGCols -1 ) continue;
+        int row = sp_y - my_[n];
+        int x = kSpritesFirstCol + sprite_x(n);
+        if(is_double_height_sprite(n))
+        {
+          row = (sp_y - my_[n])/2;
+        }
+        if(l != nullptr)
+        {
+          uint16_t addr = get_sprite_ptr(n);
+          for(int i=0; i < 3 ; i++)
+            l->sprite_data[n][i] = c64_->mem_->vic_read_byte(addr + row * 3 + i);
+          l->sprite_x[n] = x;
+          l->sprites |= (1 << n);
+        }
+        // check sprite background collision
+        detect_sprite_background_collision(x,y_gfx,n,row);
       }
-      int x = kGFirstCol + column * 8;
-      int line = rstr - kGFirstLine;
-      int row = line/8;
-      int char_row = line % 8;
-      /* retrieve screen character */
-      uint8_t c = get_screen_char(column,row);
-      /* retrieve character bitmap data */
-      uint8_t data = get_char_data(c,char_row);
-      /* retrieve color data */
-      uint8_t color  = get_char_color(column,row);
-      /* draw character */
-      if(graphic_mode_ == kMCCharMode && ISSET_BIT(color,3))
-        draw_mcchar(x,y,data,(color&0x7));
-      else if(graphic_mode_ == kCharMode)
-	      draw_char(x,y,data,color);
-      else if(graphic_mode_ == kExtBgMode)
-	      draw_ext_backcolor_char(x,y,data,color,c);
-      else
-        draw_char(x,y,data,color);
     }
   }
 }
 
-void Vic::draw_bitmap(int x, int y, uint8_t data, uint8_t color)
+/**
+ * @brief pick whether the next frame gets rasterized
+ *
+ * With a fixed setting every frame_skip'th frame is rendered, in
+ * auto mode the skip count follows the host time spent per frame.
+ */
+void Vic::update_frame_skip()
 {
-  uint8_t forec   = (color >> 4) & 0xf;
-  uint8_t bgc =  color & 0xf;
-  for(int i=0 ; i < 8 ; i++)
+  int n = frame_skip;
+  if(n == kAutoFrameSkip)
   {
-    int xoffs = x + 7 - i + horizontal_scroll();
-    /* don't draw outside (due to horizontal scroll) */
-    if(xoffs > kGFirstCol + kGResX)
-      continue;
-    /* draw pixel */
-    if(ISSET_BIT(data,i))
+    /**
+     * smoothed fraction of the frame time the host was busy,
+     * skip more once we fall behind real time and render more
+     * again when there is plenty of headroom
+     */
+    frame_load_ = (frame_load_ * 0.9) + (c64_->io_->frame_load() * 0.1);
+    if(frame_load_ > 0.98 && auto_skip_ < kMaxFrameSkip)
     {
-      c64_->io_->screen_update_pixel(
-        xoffs,
-        y,
-        forec);
+      auto_skip_++;
+      frame_load_ = 0.85;
     }
-    else
+    else if(frame_load_ < 0.7 && auto_skip_ > 1)
     {
-      c64_->io_->screen_update_pixel(
-        xoffs,
-        y,
-        bgc);
+      auto_skip_--;
+      frame_load_ = 0.85;
     }
+    n = auto_skip_;
   }
+  if(n < 1) n = 1;
+  frame_skip_c_ = (frame_skip_c_ + 1) % n;
+  render_frame_ = (frame_skip_c_ == 0);
 }
+#endif /* DESKTOP */
 
 void Vic::detect_sprite_background_collision(int x, int y, int sprite, int row){
   int swid = is_double_width_sprite(sprite) ? 2 : 1;
@@ -860,144 +903,6 @@ void Vic::detect_sprite_sprite_collision(int n){
   }
 }
 
-void Vic::draw_mcbitmap(int x, int y, uint8_t data, uint8_t scolor, uint8_t rcolor)
-{
-  for(int i=0 ; i < 4 ; i++)
-  {
-    /* color */
-    uint8_t c;
-    /* color source */
-    uint8_t cs = ((data >> i*2) & 0x3);
-    switch(cs)
-    {
-    case 0:
-      c = bgcolor_[0];
-      break;
-    case 1:
-      c = (scolor >> 4) & 0xf;
-      break;
-    case 2:
-      c = scolor & 0xf;
-      break;
-    case 3:
-      c = rcolor;
-      break;
-    }
-    int xoffs = x + 7 - i * 2 + horizontal_scroll();
-    c64_->io_->screen_update_pixel(
-      xoffs,
-      y,
-      c);
-    c64_->io_->screen_update_pixel(
-      xoffs + 1,
-      y,
-      c);
-  }
-}
-
-void Vic::draw_raster_bitmap_mode()
-{
-  int rstr = raster_counter();
-  int y = rstr - kFirstVisibleLine;
-  if((rstr >= kGFirstLine) &&
-     (rstr < kGLastLine) &&
-     !is_screen_off())
-  {
-    /* draw background */
-    c64_->io_->screen_draw_rect(kGFirstCol,y,kGResX,bgcolor_[0]);
-    /* draw bitmaps */
-    for(int column=0; column < kGCols ; column++)
-    {
-      int x = kGFirstCol + column * 8;
-      int line = rstr - kGFirstLine;
-      int row = line/8;
-      int bitmap_row = line % 8;
-      /* retrieve bitmap data */
-      uint8_t data = get_bitmap_data(column,row,bitmap_row);
-      /* retrieve color data */
-      uint8_t scolor = get_screen_char(column,row);
-      /* draw bitmap */
-      if(graphic_mode_ == kBitmapMode)
-        draw_bitmap(x,y,data,scolor);
-      else{
-        uint8_t rcolor = get_char_color(column,row);
-        draw_mcbitmap(x,y,data,scolor,rcolor);
-      }
-    }
-  }
-}
-
-void Vic::draw_mcsprite(int x, int y, int sprite, int row)
-{
-  uint8_t swid = is_double_width_sprite(sprite) == true ? 2 : 1;
-  uint16_t addr = get_sprite_ptr(sprite);
-
-  uint8_t side_border_offset = 0;
-  uint8_t top_border_offset=0;
-  uint8_t btm_border_offset=0;
-
-  // 38 col mode
-  if(!ISSET_BIT(cr2_,3))
-    side_border_offset = 8;
-
-  // 24 line mode
-  if(!ISSET_BIT(cr1_,3))
-  {
-    top_border_offset=2;
-    btm_border_offset=4;
-  }
-  uint16_t minX = kGFirstCol+side_border_offset;
-  uint16_t maxX = kGResX+kGFirstCol-side_border_offset;
-  uint16_t minY = kGFirstCol + top_border_offset;
-  uint16_t maxY = kGResY+kGFirstCol - btm_border_offset;
-
-  for(int w=0;w<swid;w++)
-  {
-    for (int i=0; i < 3 ; i++)
-    {
-      uint8_t  data = c64_->mem_->vic_read_byte(addr + row * 3 + i);
-      for (int j=0; j < 4; j++)
-      {
-	/* color */
-	uint8_t c = 0;
-	/* color source */
-	uint8_t cs = ((data >> j*2) & 0x3);
-	switch(cs)
-	{
-	/* transparent */
-	case 0:
-	  break;
-	case 1:
-	  c = sprite_shared_colors_[0];
-	  break;
-	case 2:
-	  c = sprite_colors_[sprite];
-	  break;
-	case 3:
-	  c = sprite_shared_colors_[1];
-	  break;
-	}
-	/* draw if not transparent */
-	if(cs != 0)
-	{
-	  uint16_t newX = (x+w+(i*8*swid) + (8*swid) - (j*swid*2));
-
-	  if(newX > minX && y >= minY && newX <= maxX && y < maxY)
-	    c64_->io_->screen_update_pixel(newX,y,c);
-
-	  newX++;
-	  if(newX > minX && y >= minY && newX <= maxX && y < maxY)
-	    c64_->io_->screen_update_pixel(newX,y,c);
-
-	  newX++;
-	  if(is_double_width_sprite(sprite) && newX > minX && y >= minY && newX <= maxX && y < maxY)
-	    c64_->io_->screen_update_pixel(newX,y,c);
-	}
-      }
-    }
-  }
-}
-
 uint8_t Vic::get_sprite_pixel(int n,int x,int y){
   int swid = is_double_width_sprite(n) ? 2 : 1;
   uint16_t addr = get_sprite_ptr(n);
@@ -1017,119 +922,6 @@ uint8_t Vic::get_sprite_pixel(int n,int x,int y){
   }
 }
 
-void Vic::draw_sprite(int x, int y, int sprite, int row)
-{
-  uint8_t swid = is_double_width_sprite(sprite) == true ? 2 : 1;
-  uint16_t addr = get_sprite_ptr(sprite);
-
-  uint8_t side_border_offset = 0;
-  uint8_t top_border_offset=0;
-  uint8_t btm_border_offset=0;
-
-  uint16_t minX = kGFirstCol+side_border_offset;
-  uint16_t maxX = kGResX+kGFirstCol-side_border_offset;
-  uint16_t minY = kGFirstCol + top_border_offset;
-  uint16_t maxY = kGResY+kGFirstCol - btm_border_offset;
-
-  // 38 col mode
-  if(!ISSET_BIT(cr2_,3))
-    side_border_offset = 8;
-
-  // 24 line mode
-  if(!ISSET_BIT(cr1_,3))
-  {
-    top_border_offset=2;
-    btm_border_offset=4;
-  }
-
-  for(int w=0;w<swid;w++)
-  {
-    for (int i=0; i < 3 ; i++)
-    {
-      uint8_t data = c64_->mem_->vic_read_byte(addr + row * 3 + i);
-
-      for (int j=0; j < 8; j++)
-      {
-        if(ISSET_BIT(data,j))
-        {
-          uint16_t newX = (x+w + (i*8*swid) + (8*swid) - (j*swid)) ;
-
-          if(newX > minX && y >= minY && newX <= maxX && y < maxY)
-            c64_->io_->screen_update_pixel(newX,y,sprite_colors_[sprite]);
-        }
-      //   if(ISSET_BIT(data,j))
-      //   {
-      //     int new_x = (x+w + (i*8*swid) + (8*swid) - (j*swid)) ;
-      //     int color = sprite_colors_[sprite];
-      //     int side_border_offset = 0;
-      //     int top_border_offset  = 0;
-      //     int btm_border_offset  = 0;
-      //     /* check 38 cols mode */
-      //     if(!ISSET_BIT(cr2_,3))
-      //       side_border_offset = 8;
-      //     /* check 24 line mode */
-      //     if(!ISSET_BIT(cr1_,3))
-      //     {
-      //       top_border_offset = 2;
-      //       btm_border_offset = 4;
-      //     }
-      //     /* check bounds */
-      //     if(new_x <= kGFirstCol+side_border_offset ||
-      //        y < kGFirstCol + top_border_offset ||
-      //        new_x > kGResX+kGFirstCol-side_border_offset ||
-      //        y >= kGResY+kGFirstCol - btm_border_offset)
-      //       color = border_color_;
-      //     /* update pixel */
-      //     c64_->io_->screen_update_pixel(
-      //       new_x,
-      //       y,
-      //       color);
-      //   }
-      }
-    }
-  }
-}
-
-void Vic::draw_raster_sprites()
-{
-  if(sprite_enabled_ != 0)
-  {
-    int rstr = raster_counter();
-    int y = rstr - kFirstVisibleLine;
-    int sp_y = rstr - kSpritesFirstLine;
-    int y_gfx = rstr - kGFirstLine;
-
-    /* loop over sprites reverse order */
-    for(int n=7; n >= 0 ; n--)
-    {
-      int height = is_double_height_sprite(n) ? kSpriteHeight * 2 : kSpriteHeight;
-      /* check if the sprite is visible */
-      if(is_sprite_enabled(n) &&
-         sp_y >= my_[n] &&
-         sp_y < my_[n] + height)
-      {
-        int row = sp_y - my_[n];
-        int x = kSpritesFirstCol + sprite_x(n);
-        if(is_double_height_sprite(n))
-        {
-          row = (sp_y - my_[n])/2;
-        }
-        // check sprite background collision
-        detect_sprite_background_collision(x,y_gfx,n,row);
-
-        if(is_multicolor_sprite(n))
-        {
-          draw_mcsprite(x,y,n,row);
-        }
-        else
-        {
-          draw_sprite(x,y,n,row);
-        }
-      }
-    }
-  }
-}
-
 // helpers ///////////////////////////////////////////////////////////////////
 
 void Vic::raster_counter(int v)
@@ -82,6 +82,7 @@ class Vic
     inline bool is_screen_off();
     inline bool is_bad_line();
     inline bool raster_irq_enabled();
+    inline void irq_line();
     inline uint8_t vertical_scroll();
     inline uint8_t horizontal_scroll();
     inline bool is_sprite_enabled(int n);
@@ -95,36 +96,50 @@ class Vic
     void        detect_sprite_sprite_collision(int n);
     void        detect_sprite_background_collision(int x, int y, int sprite, int row);
     /* graphics */
-    inline void draw_raster_char_mode();
-    inline void draw_raster_bitmap_mode();
-    inline void draw_ext_backcolor_char(int x, int y, uint8_t data, uint8_t color, uint8_t c);
-    inline void draw_raster_sprites();
-    inline void draw_sprite(int x, int y, int sprite, int row);
-    inline void draw_mcsprite(int x, int y, int sprite, int row);
-    inline void draw_char(int x, int y, uint8_t data, uint8_t color);
-    inline void draw_mcchar(int x, int y, uint8_t data, uint8_t color);
-    inline void draw_bitmap(int x, int y, uint8_t data, uint8_t color);
-    inline void draw_mcbitmap(int x, int y, uint8_t data, uint8_t scolor, uint8_t rcolor);
     inline uint8_t get_screen_char(int column, int row);
     inline uint8_t get_char_color(int column, int row);
     inline uint8_t get_char_data(int chr, int line);
     inline uint8_t get_bitmap_data(int column, int row, int line);
     uint8_t get_sprite_pixel(int n,int x,int y);
     inline void set_graphic_mode();
+    #if DESKTOP
+    /* rendering */
+    VicRenderer *renderer_;
+    void fetch_raster_line(VicLine *l, int rstr);
+    void fetch_raster_sprites(VicLine *l, int rstr);
+    StateHash *statehash_;
+    #endif
+    /* frame skipping */
+    int frame_skip_c_;
+    int auto_skip_;
+    double frame_load_;
+    bool render_frame_;
+    void update_frame_skip();
 
   public:
     Vic(C64 *c64);
+    ~Vic();
 
     void reset();
     bool emulate();
 
     void write_register(uint8_t r, uint8_t v);
     uint8_t read_register(uint8_t r);
+    uint8_t peek_register(uint8_t r);
 
     unsigned int frames(){return frame_c;};
     uint16_t get_sprite_ptr(int n);
     int raster_counter();
     void setLightPen(uint16_t x,uint8_t y);
+    #if DESKTOP
+    /* boot snapshot */
+    void snapshot(Snapshot &s);
+    #endif
+
+    /* render every Nth frame, 1 renders all frames */
+    static int frame_skip;
+    static const int kAutoFrameSkip = 0;
+    static const int kMaxFrameSkip = 5;
 
     /* constants */
     static const int kScreenLines = 312; /* PAL */
@@ -134,6 +149,7 @@ class Vic
     static const int kFirstVisibleLine = 14;
     static const int kLastVisibleLine = 298;
     static const int kRefrehRate = 19656; /* Fixed PAL refreshrate */
+    static constexpr unsigned int kClockFrequency = 985248; /* PAL phi2 in Hz */
     static const int kLineCycles = 63; /* PAL 63*312 ~19656 raster cycles */
     static const int kBadLineCycles = 23;
     /* TODO: FIX REFRESH RATE TO SETTING */
@@ -0,0 +1,398 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * vicrenderer.cpp
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <c64.h> /* All classes are loaded through c64.h */
+
+#if DESKTOP
+
+#include <cstring>
+#include <thread>
+#include <chrono>
+
+
+// ctor and dtor /////////////////////////////////////////////////////////////
+
+VicRenderer::VicRenderer(C64 *c64) :
+  c64_(c64),
+  running_(true),
+  threaded_(true)
+{
+  lines_ = new RingBuffer<VicLine,512>();
+  int error = pthread_create(&threadid_, NULL, &_Render_Thread, this);
+  if (error != 0) {
+    /* fall back to rendering on the emulation thread */
+    fprintf(stderr, "[VIC] Render thread can't be created :[%s]\n", strerror(error));
+    threaded_ = false;
+  }
+  D("[EMU] VicRenderer initialized (%s).\n",(threaded_ ? "threaded" : "inline"));
+}
+
+VicRenderer::~VicRenderer()
+{
+  running_.store(false, std::memory_order_release);
+  if (threaded_) pthread_join(threadid_, NULL);
+  delete lines_;
+}
+
+// producer side (emulation thread) //////////////////////////////////////////
+
+/**
+ * @brief get the next free line record
+ *
+ * Only blocks when the renderer is a full ring behind
+ */
+VicLine *VicRenderer::acquire()
+{
+  VicLine *l;
+  while((l = lines_->acquire()) == nullptr)
+    std::this_thread::yield();
+  return l;
+}
+
+/**
+ * @brief hand the acquired line record to the renderer
+ */
+void VicRenderer::publish()
+{
+  lines_->publish();
+  if (!threaded_) {
+    render_line(*lines_->front());
+    lines_->pop();
+  }
+}
+
+/**
+ * @brief wait until every published line is rasterized
+ *
+ * Called at the end of a frame before the framebuffer
+ * is presented.
+ */
+void VicRenderer::sync()
+{
+  while(!lines_->empty())
+    std::this_thread::yield();
+}
+
+// consumer side (render thread) /////////////////////////////////////////////
+
+void *VicRenderer::render_thread(void)
+{
+  pthread_setname_np(pthread_self(), "Vic Renderer");
+  unsigned int idle = 0;
+
+  while (running_.load(std::memory_order_acquire)) {
+    VicLine *l = lines_->front();
+    if (l == nullptr) {
+      /* spin briefly, then give the core away */
+      if (++idle < 64) continue;
+      if (idle < 1024) std::this_thread::yield();
+      else std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+    idle = 0;
+    render_line(*l);
+    lines_->pop();
+  }
+  return NULL;
+}
+
+void VicRenderer::render_line(const VicLine &l)
+{
+  int y = l.raster - Vic::kFirstVisibleLine;
+  /* draw border */
+  c64_->io_->screen_draw_border(y,l.border_color);
+  /* draw raster on current graphic mode */
+  switch(l.graphic_mode)
+  {
+  case Vic::kCharMode:
+  case Vic::kMCCharMode:
+  case Vic::kExtBgMode:
+    draw_raster_char_mode(l,y);
+    break;
+  case Vic::kBitmapMode:
+  case Vic::kMCBitmapMode:
+    draw_raster_bitmap_mode(l,y);
+    break;
+  default:
+    D("unsupported graphic mode: %d\n",l.graphic_mode);
+    return;
+  }
+  /* draw sprites */
+  draw_raster_sprites(l,y);
+}
+
+// raster drawing  ///////////////////////////////////////////////////////////
+
+void VicRenderer::draw_char(const VicLine &l, int x, int y, uint8_t data, uint8_t color)
+{
+  for(int i=0 ; i < 8 ; i++)
+  {
+    int xoffs = x + 7 - i + (l.cr2&0x7);
+    /* don't draw outside (due to horizontal scroll) */
+    if(xoffs > Vic::kGFirstCol + Vic::kGResX)
+      continue;
+    /* draw pixel */
+    if(ISSET_BIT(data,i))
+    {
+      c64_->io_->screen_update_pixel(xoffs,y,color);
+    }
+  }
+}
+
+void VicRenderer::draw_ext_backcolor_char(const VicLine &l, int x, int y, uint8_t data, uint8_t color, uint8_t c)
+{
+  c>>=6;
+  for(int i=0 ; i < 8 ; i++)
+  {
+    int xoffs = x + 7 - i + (l.cr2&0x7);
+    /* don't draw outside (due to horizontal scroll) */
+    if(xoffs > Vic::kGFirstCol + Vic::kGResX)
+      continue;
+    /* draw pixel */
+    if(ISSET_BIT(data,i))
+      c64_->io_->screen_update_pixel(xoffs,y,color);
+    else
+      c64_->io_->screen_update_pixel(xoffs,y,l.bgcolor[c]);
+  }
+}
+
+void VicRenderer::draw_mcchar(const VicLine &l, int x, int y, uint8_t data, uint8_t color)
+{
+  for(int i=0 ; i < 4 ; i++)
+  {
+    /* color */
+    uint8_t c;
+    /* color source */
+    uint8_t cs = ((data >> i*2) & 0x3);
+    if(cs == 3)
+      c = color;
+    else
+      c = l.bgcolor[cs];
+    int xoffs = x + 7 - i * 2 + (l.cr2&0x7);
+    c64_->io_->screen_update_pixel(xoffs,y,c);
+    c64_->io_->screen_update_pixel(xoffs + 1,y,c);
+  }
+}
+
+void VicRenderer::draw_raster_char_mode(const VicLine &l, int y)
+{
+  if(!l.display)
+    return;
+  /* draw background */
+  if(!ISSET_BIT(l.cr2,3)) // 38 columns
+    c64_->io_->screen_draw_rect(Vic::kGFirstCol+8,y,Vic::kGResX-16,l.bgcolor[0]);
+  else
+    c64_->io_->screen_draw_rect(Vic::kGFirstCol,y,Vic::kGResX,l.bgcolor[0]);
+
+  /* draw characters */
+  for(int column=0; column < Vic::kGCols ; column++)
+  {
+    /* check 38 cols mode */
+    if(!ISSET_BIT(l.cr2,3))
+    {
+      if (column == 0) continue;
+      if (column == Vic::kGCols -1 ) continue;
+    }
+    int x = Vic::kGFirstCol + column * 8;
+    uint8_t c     = l.video[column];
+    uint8_t data  = l.data[column];
+    uint8_t color = l.color[column];
+    /* draw character */
+    if(l.graphic_mode == Vic::kMCCharMode && ISSET_BIT(color,3))
+      draw_mcchar(l,x,y,data,(color&0x7));
+    else if(l.graphic_mode == Vic::kExtBgMode)
+      draw_ext_backcolor_char(l,x,y,data,color,c);
+    else
+      draw_char(l,x,y,data,color);
+  }
+}
+
+void VicRenderer::draw_bitmap(const VicLine &l, int x, int y, uint8_t data, uint8_t color)
+{
+  uint8_t forec = (color >> 4) & 0xf;
+  uint8_t bgc   =  color & 0xf;
+  for(int i=0 ; i < 8 ; i++)
+  {
+    int xoffs = x + 7 - i + (l.cr2&0x7);
+    /* don't draw outside (due to horizontal scroll) */
+    if(xoffs > Vic::kGFirstCol + Vic::kGResX)
+      continue;
+    /* draw pixel */
+    c64_->io_->screen_update_pixel(xoffs,y,(ISSET_BIT(data,i) ? forec : bgc));
+  }
+}
+
+void VicRenderer::draw_mcbitmap(const VicLine &l, int x, int y, uint8_t data, uint8_t scolor, uint8_t rcolor)
+{
+  for(int i=0 ; i < 4 ; i++)
+  {
+    /* color */
+    uint8_t c;
+    /* color source */
+    uint8_t cs = ((data >> i*2) & 0x3);
+    switch(cs)
+    {
+    case 0:
+      c = l.bgcolor[0];
+      break;
+    case 1:
+      c = (scolor >> 4) & 0xf;
+      break;
+    case 2:
+      c = scolor & 0xf;
+      break;
+    default:
+      c = rcolor;
+      break;
+    }
+    int xoffs = x + 7 - i * 2 + (l.cr2&0x7);
+    c64_->io_->screen_update_pixel(xoffs,y,c);
+    c64_->io_->screen_update_pixel(xoffs + 1,y,c);
+  }
+}
+
+void VicRenderer::draw_raster_bitmap_mode(const VicLine &l, int y)
+{
+  if(!l.display)
+    return;
+  /* draw background */
+  c64_->io_->screen_draw_rect(Vic::kGFirstCol,y,Vic::kGResX,l.bgcolor[0]);
+  /* draw bitmaps */
+  for(int column=0; column < Vic::kGCols ; column++)
+  {
+    int x = Vic::kGFirstCol + column * 8;
+    /* video matrix holds the colors in bitmap mode */
+    if(l.graphic_mode == Vic::kBitmapMode)
+      draw_bitmap(l,x,y,l.data[column],l.video[column]);
+    else
+      draw_mcbitmap(l,x,y,l.data[column],l.video[column],l.color[column]);
+  }
+}
+
+void VicRenderer::draw_mcsprite(const VicLine &l, int x, int y, int sprite)
+{
+  uint8_t swid = ISSET_BIT(l.sprite_double_width,sprite) ? 2 : 1;
+
+  uint8_t side_border_offset = 0;
+  uint8_t top_border_offset=0;
+  uint8_t btm_border_offset=0;
+
+  // 38 col mode
+  if(!ISSET_BIT(l.cr2,3))
+    side_border_offset = 8;
+
+  // 24 line mode
+  if(!ISSET_BIT(l.cr1,3))
+  {
+    top_border_offset=2;
+    btm_border_offset=4;
+  }
+  uint16_t minX = Vic::kGFirstCol+side_border_offset;
+  uint16_t maxX = Vic::kGResX+Vic::kGFirstCol-side_border_offset;
+  uint16_t minY = Vic::kGFirstCol + top_border_offset;
+  uint16_t maxY = Vic::kGResY+Vic::kGFirstCol - btm_border_offset;
+
+  for(int w=0;w<swid;w++)
+  {
+    for (int i=0; i < 3 ; i++)
+    {
+      uint8_t data = l.sprite_data[sprite][i];
+      for (int j=0; j < 4; j++)
+      {
+        /* color */
+        uint8_t c = 0;
+        /* color source */
+        uint8_t cs = ((data >> j*2) & 0x3);
+        switch(cs)
+        {
+        /* transparent */
+        case 0:
+          continue;
+        case 1:
+          c = l.sprite_shared_colors[0];
+          break;
+        case 2:
+          c = l.sprite_colors[sprite];
+          break;
+        case 3:
+          c = l.sprite_shared_colors[1];
+          break;
+        }
+        uint16_t newX = (x+w+(i*8*swid) + (8*swid) - (j*swid*2));
+
+        if(newX > minX && y >= minY && newX <= maxX && y < maxY)
+          c64_->io_->screen_update_pixel(newX,y,c);
+
+        newX++;
+        if(newX > minX && y >= minY && newX <= maxX && y < maxY)
+          c64_->io_->screen_update_pixel(newX,y,c);
+
+        newX++;
+        if(swid == 2 && newX > minX && y >= minY && newX <= maxX && y < maxY)
+          c64_->io_->screen_update_pixel(newX,y,c);
+      }
+    }
+  }
+}
+
+void VicRenderer::draw_sprite(const VicLine &l, int x, int y, int sprite)
+{
+  uint8_t swid = ISSET_BIT(l.sprite_double_width,sprite) ? 2 : 1;
+
+  /* NOTE: unlike multicolor sprites the border offsets are not applied here */
+  uint16_t minX = Vic::kGFirstCol;
+  uint16_t maxX = Vic::kGResX+Vic::kGFirstCol;
+  uint16_t minY = Vic::kGFirstCol;
+  uint16_t maxY = Vic::kGResY+Vic::kGFirstCol;
+
+  for(int w=0;w<swid;w++)
+  {
+    for (int i=0; i < 3 ; i++)
+    {
+      uint8_t data = l.sprite_data[sprite][i];
+      for (int j=0; j < 8; j++)
+      {
+        if(ISSET_BIT(data,j))
+        {
+          uint16_t newX = (x+w + (i*8*swid) + (8*swid) - (j*swid));
+
+          if(newX > minX && y >= minY && newX <= maxX && y < maxY)
+            c64_->io_->screen_update_pixel(newX,y,l.sprite_colors[sprite]);
+        }
+      }
+    }
+  }
+}
+
+void VicRenderer::draw_raster_sprites(const VicLine &l, int y)
+{
+  /* loop over sprites reverse order */
+  for(int n=7; n >= 0 ; n--)
+  {
+    if(!ISSET_BIT(l.sprites,n))
+      continue;
+    if(ISSET_BIT(l.sprite_multicolor,n))
+      draw_mcsprite(l,l.sprite_x[n],y,n);
+    else
+      draw_sprite(l,l.sprite_x[n],y,n);
+  }
+}
+
+#endif /* DESKTOP */
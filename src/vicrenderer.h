@@ -0,0 +1,109 @@
+/*
+ * emudore, Commodore 64 emulator
+ * Copyright (c) 2016, Mario Ballano <mballano@gmail.com>
+ * Changes and additions (c) 2025, LouD <emudore@mail.loudai.nl>
+ *
+ * vicrenderer.h
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef EMUDORE_VICRENDERER_H
+#define EMUDORE_VICRENDERER_H
+
+#if DESKTOP
+
+#include <atomic>
+#include <pthread.h>
+
+#include <ringbuffer.h>
+
+
+/**
+ * @brief raster line record
+ *
+ * Everything needed to draw one raster line, captured by
+ * the Vic on the emulation thread when the line starts.
+ * The renderer never touches emulated memory or registers.
+ */
+struct VicLine
+{
+  int raster;
+  /* register snapshot */
+  uint8_t cr1;
+  uint8_t cr2;
+  uint8_t border_color;
+  uint8_t bgcolor[4];
+  Vic::kGraphicMode graphic_mode;
+  /* graphics area is visible on this line */
+  bool display;
+  /* fetched video matrix, color ram and char/bitmap data */
+  uint8_t video[Vic::kGCols];
+  uint8_t color[Vic::kGCols];
+  uint8_t data[Vic::kGCols];
+  /* sprites visible on this line */
+  uint8_t sprites;
+  uint8_t sprite_multicolor;
+  uint8_t sprite_double_width;
+  uint8_t sprite_shared_colors[2];
+  uint8_t sprite_colors[8];
+  int sprite_x[8];
+  uint8_t sprite_data[8][3];
+};
+
+/**
+ * @brief VIC-II raster renderer
+ *
+ * Consumes VicLine records from a lock-free ring and rasterizes
+ * them into the IO framebuffer on its own thread, so pixel work
+ * runs on a second host core next to the emulation thread.
+ */
+class VicRenderer
+{
+  private:
+    C64 *c64_;
+    RingBuffer<VicLine,512> *lines_;
+    pthread_t threadid_;
+    std::atomic<bool> running_;
+    bool threaded_;
+
+    void *render_thread(void);
+    void render_line(const VicLine &l);
+    /* graphics */
+    void draw_raster_char_mode(const VicLine &l, int y);
+    void draw_raster_bitmap_mode(const VicLine &l, int y);
+    void draw_raster_sprites(const VicLine &l, int y);
+    inline void draw_char(const VicLine &l, int x, int y, uint8_t data, uint8_t color);
+    inline void draw_mcchar(const VicLine &l, int x, int y, uint8_t data, uint8_t color);
+    inline void draw_ext_backcolor_char(const VicLine &l, int x, int y, uint8_t data, uint8_t color, uint8_t c);
+    inline void draw_bitmap(const VicLine &l, int x, int y, uint8_t data, uint8_t color);
+    inline void draw_mcbitmap(const VicLine &l, int x, int y, uint8_t data, uint8_t scolor, uint8_t rcolor);
+    inline void draw_sprite(const VicLine &l, int x, int y, int sprite);
+    inline void draw_mcsprite(const VicLine &l, int x, int y, int sprite);
+
+  public:
+    VicRenderer(C64 *c64);
+    ~VicRenderer();
+    static void *_Render_Thread(void *context)
+    { /* Required for supplying private function to pthread_create */
+      return ((VicRenderer *)context)->render_thread();
+    }
+
+    VicLine *acquire();
+    void publish();
+    void sync();
+};
+
+#endif /* DESKTOP */
+
+#endif /* EMUDORE_VICRENDERER_H */